@@ -35,20 +35,15 @@ extern "C" {
 
 
 
+/* column-major table of fitness cases, see dataset.h */
+struct fitness_dataset;
+
 typedef struct
 {
     individual* current_individual;
-#ifndef PART_B
-    double x;
-#else
-    double area;
-    double perimeter;
-    double major_axis_length;
-    double minor_axis_length;
-    double eccentricity;
-    double convex_area;
-    double extent;
-#endif
+    /* table and case read by the terminals of the per-case evaluator */
+    const struct fitness_dataset* cases;
+    int case_index;
 } globaldata;
 
 extern globaldata g;
@@ -0,0 +1,93 @@
+#pragma once
+/*
+ *  Copyright (C) 2024  Brett Terpstra
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FINALPROJECT_DATASET_H
+#define FINALPROJECT_DATASET_H
+
+#include <cstddef>
+#include <vector>
+#include <rice_loader.h>
+
+/**
+ * column layout of the fitness case table. the last column always holds the expected output of the case.
+ */
+enum dataset_column : int
+{
+#ifdef PART_B
+    COL_AREA,
+    COL_PERIMETER,
+    COL_MAJOR_AXIS_LENGTH,
+    COL_MINOR_AXIS_LENGTH,
+    COL_ECCENTRICITY,
+    COL_CONVEX_AREA,
+    COL_EXTENT,
+    COL_CLASS,
+#else
+    COL_X,
+    COL_Y,
+#endif
+    COL_COUNT
+};
+
+/**
+ * Column-major table of fitness cases. Every column lives in one aligned allocation and starts on a 64 byte boundary,
+ * so the batch evaluator's terminals can stream a column straight out of it. The table is filled once and then only
+ * read, which means every evaluation thread can share the same instance without locking.
+ */
+class fitness_dataset
+{
+    public:
+        static constexpr std::size_t alignment = 64;
+
+        explicit fitness_dataset(int count);
+
+        fitness_dataset(const fitness_dataset&) = delete;
+
+        fitness_dataset& operator=(const fitness_dataset&) = delete;
+
+        ~fitness_dataset();
+
+        [[nodiscard]] inline int size() const
+        { return count; }
+
+        [[nodiscard]] inline const double* column(int c) const
+        { return block + static_cast<std::size_t>(c) * stride; }
+
+        [[nodiscard]] inline double* column(int c)
+        { return block + static_cast<std::size_t>(c) * stride; }
+
+        [[nodiscard]] inline double value(int c, int i) const
+        { return column(c)[i]; }
+
+    private:
+        int count;
+        // number of doubles from the start of one column to the start of the next
+        std::size_t stride;
+        double* block;
+};
+
+#ifdef PART_B
+
+/**
+ * builds a table from loaded rice records. Cammeo grains get a class value of 50 and Osmancik grains -50.
+ */
+fitness_dataset* make_rice_dataset(const std::vector<rice_record>& records, std::size_t amount);
+
+#endif
+
+#endif //FINALPROJECT_DATASET_H
@@ -57,6 +57,26 @@ DATATYPE f_extent(int tree, farg* args);
 void f_erc_gen(DATATYPE*);
 char* f_erc_print(DATATYPE);
 
+void v_multiply(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_protdivide(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_add(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_subtract(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_sin(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_cos(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_exp(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_rlog(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+#ifndef PART_B
+void v_var(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+#else
+void v_area(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_perimeter(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_major_axis_length(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_minor_axis_length(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_eccentricity(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_convex_area(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+void v_extent(int tree, batchinfo* b, DATATYPE* out, DATATYPE** args);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,229 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+
+/* tree arenas.  each population owns an arena that holds the lnode arrays
+ * of all its trees.  trees are carved out of large blocks by bumping a
+ * pointer, and nothing is freed individually:  when the population is
+ * retired the whole arena is reset in one step and kept for a later
+ * population, so in the steady state the old and new generations just
+ * trade two arenas back and forth.
+ *
+ * an arena has one "lane" (chain of blocks) per thread, so breeding
+ * threads can allocate at the same time without locking.  a thread only
+ * allocates from an arena while it is bound to it with bind_tree_arena();
+ * at all other times trees come from the heap as before.
+ */
+
+typedef struct _arena_block
+{
+     struct _arena_block *next;
+     int size;                 /* lnodes in this block */
+     int used;                 /* lnodes handed out so far */
+} arena_block;
+
+typedef struct
+{
+     arena_block *first;
+     arena_block *cur;         /* the block currently being filled */
+} arena_lane;
+
+struct _tree_arena
+{
+     arena_lane *lanes;
+     int lanecount;
+     struct _tree_arena *next; /* link in the spare list */
+};
+
+/* the lnodes of a block follow its header. */
+#define BLOCK_DATA(b)  ((lnode *)((b)+1))
+
+static int lane_count = 1;
+static tree_arena *spare_arenas = NULL;
+
+static _Thread_local tree_arena *current_arena = NULL;
+static _Thread_local int current_lane = 0;
+
+/* initialize_tree_arenas()
+ *
+ * sets the number of lanes given to arenas created from now on:  one for
+ * the main thread plus one for each of workers threads.
+ */
+
+void initialize_tree_arenas ( int workers )
+{
+     lane_count = workers+1;
+}
+
+/* free_tree_arenas()
+ *
+ * frees all the retired arenas.  call after every population has been
+ * freed.
+ */
+
+void free_tree_arenas ( void )
+{
+     tree_arena *a;
+     arena_block *b, *n;
+     int i;
+
+     while ( spare_arenas )
+     {
+          a = spare_arenas;
+          spare_arenas = a->next;
+          for ( i = 0; i < a->lanecount; ++i )
+               for ( b = a->lanes[i].first; b; b = n )
+               {
+                    n = b->next;
+                    FREE ( b );
+               }
+          FREE ( a->lanes );
+          FREE ( a );
+     }
+}
+
+/* get_tree_arena()
+ *
+ * returns an empty arena, reusing a retired one if there is one.
+ */
+
+tree_arena *get_tree_arena ( void )
+{
+     tree_arena *a;
+
+     if ( spare_arenas && spare_arenas->lanecount == lane_count )
+     {
+          a = spare_arenas;
+          spare_arenas = a->next;
+          a->next = NULL;
+          return a;
+     }
+
+     a = (tree_arena *)MALLOC ( sizeof ( tree_arena ) );
+     a->lanecount = lane_count;
+     a->lanes = (arena_lane *)MALLOC ( lane_count * sizeof ( arena_lane ) );
+     memset ( a->lanes, 0, lane_count * sizeof ( arena_lane ) );
+     a->next = NULL;
+     return a;
+}
+
+/* retire_tree_arena()
+ *
+ * empties an arena, invalidating every tree allocated from it, and keeps
+ * its blocks for reuse.
+ */
+
+void retire_tree_arena ( tree_arena *a )
+{
+     int i;
+
+     if ( a == NULL )
+          return;
+
+     for ( i = 0; i < a->lanecount; ++i )
+     {
+          a->lanes[i].cur = a->lanes[i].first;
+          if ( a->lanes[i].first )
+               a->lanes[i].first->used = 0;
+     }
+     a->next = spare_arenas;
+     spare_arenas = a;
+}
+
+/* bind_tree_arena()
+ *
+ * makes the calling thread allocate trees from the given arena, or from
+ * the heap if it is NULL.
+ */
+
+void bind_tree_arena ( tree_arena *a )
+{
+     current_arena = a;
+}
+
+/* bind_arena_lane()
+ *
+ * sets which lane of an arena the calling thread allocates from.
+ */
+
+void bind_arena_lane ( int lane )
+{
+     current_lane = lane;
+}
+
+/* arena_alloc()
+ *
+ * returns space for count lnodes from the calling thread's arena, or NULL
+ * if the thread is not bound to one.
+ */
+
+lnode *arena_alloc ( int count )
+{
+     arena_lane *l;
+     arena_block *b;
+     lnode *p;
+     int size;
+
+     if ( current_arena == NULL || current_lane >= current_arena->lanecount )
+          return NULL;
+
+     l = current_arena->lanes+current_lane;
+
+     /* move on to the next retained block until one has room. */
+     while ( l->cur && l->cur->used + count > l->cur->size )
+     {
+          l->cur = l->cur->next;
+          if ( l->cur )
+               l->cur->used = 0;
+     }
+
+     if ( l->cur == NULL )
+     {
+	  /* no room anywhere; add a new block to the end of the chain. */
+          size = count > ARENA_BLOCK ? count : ARENA_BLOCK;
+          b = (arena_block *)MALLOC ( sizeof ( arena_block ) +
+                                      size * sizeof ( lnode ) );
+          b->next = NULL;
+          b->size = size;
+          b->used = 0;
+          if ( l->first == NULL )
+               l->first = b;
+          else
+          {
+               arena_block *t = l->first;
+               while ( t->next )
+                    t = t->next;
+               t->next = b;
+          }
+          l->cur = b;
+     }
+
+     p = BLOCK_DATA(l->cur) + l->cur->used;
+     l->cur->used += count;
+     return p;
+}
@@ -26,10 +26,14 @@
  */
 
 #include <lilgp.h>
+#include <stdatomic.h>
+
+/* breeding threads share one context, so the position in the list is
+   advanced atomically. */
 
 typedef struct
 {
-     int next;
+     atomic_int next;
      int *list;
 } bestworst_data;
 
@@ -47,7 +51,7 @@ int select_bestworst ( sel_context *sc )
 {
      bestworst_data *bwd;
      bwd = (bestworst_data *)(sc->data);
-     return bwd->list[bwd->next++];
+     return bwd->list[atomic_fetch_add ( &bwd->next, 1 )];
 }
 
 /* select_best_context()
@@ -221,6 +225,6 @@ sel_context *select_random_context ( int op, sel_context *sc,
 
 int select_random ( sel_context *sc )
 {
-     return random_int ( &globrand, sc->p->size );
+     return random_int ( get_randomgen(), sc->p->size );
 }
 
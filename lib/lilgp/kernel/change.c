@@ -38,6 +38,83 @@ gp_operator operator_table[] =
          {"mutation",     operator_mutate_init},
          {NULL, NULL}};
 
+/* the work handed to each thread by change_population().  the slots
+ * [first,last) of the new population are split into one contiguous slice
+ * per thread, so every thread writes only to its own individuals.
+ */
+
+typedef struct
+{
+    population* oldpop;
+    population* newpop;
+    breedphase* bp;
+    double totalrate;
+    int prob_oper;
+    int first, last;
+    int slices;
+} breed_param;
+
+/* breed_slice()
+ *
+ * fills slots [start,end) of the new population.  the operators are
+ * handed a population that covers just that slice, so their use of
+ * newpop->next and newpop->size is unchanged.
+ */
+
+static void breed_slice(breed_param* p, int start, int end)
+{
+    population slice;
+    breedphase* bp = p->bp;
+    double r, r2;
+    int i;
+    
+    slice.ind = p->newpop->ind + start;
+    slice.size = end - start;
+    slice.next = 0;
+    slice.arena = p->newpop->arena;
+    
+    bind_tree_arena(slice.arena);
+    
+    while (slice.next < slice.size)
+    {
+        
+        /** select an operator, either stochastically or not depending on
+          the probabilistic_operators parameter. **/
+        if (p->prob_oper)
+            r = p->totalrate * random_double(get_randomgen());
+        else
+            r = p->totalrate * ((double) (start + slice.next) /
+                                (double) p->newpop->size);
+        
+        r2 = bp[1].rate;
+        for (i = 1; r2 < r;)
+            r2 += bp[++i].rate;
+#ifdef DEBUG
+        fprintf ( stderr, "picked %10.3lf; operator %d\n", r, i );
+#endif
+        
+        /* call the phase's method to do the operation. */
+        if (bp[i].operator_operate)
+            bp[i].operator_operate(p->oldpop, &slice, bp[i].data);
+    }
+    
+    bind_tree_arena(NULL);
+}
+
+/* breed_chunk()
+ *
+ * run on each pool worker to breed that worker's slice.
+ */
+
+static void breed_chunk(int thread, void* param)
+{
+    breed_param* p = (breed_param*) param;
+    int count = p->last - p->first;
+    
+    breed_slice(p, p->first + (int) ((long) count * thread / p->slices),
+                p->first + (int) ((long) count * (thread + 1) / p->slices));
+}
+
 /* change_population()
  *
  * breed the new population.
@@ -48,9 +125,10 @@ population* change_population(population* oldpop, breedphase* bp)
     population* newpop;
     int i, j;
     int numphases;
-    double totalrate = 0.0;
-    double r, r2;
-    int prob_oper = atoi(get_parameter("probabilistic_operators"));
+    breed_param param;
+    
+    param.totalrate = 0.0;
+    param.prob_oper = atoi(get_parameter("probabilistic_operators"));
     
     /* allocate the new population. */
     newpop = allocate_population(oldpop->size);
@@ -62,7 +140,7 @@ population* change_population(population* oldpop, breedphase* bp)
     /* call the start method for each phase. */
     for (i = 1; i <= numphases; ++i)
     {
-        totalrate += bp[i].rate;
+        param.totalrate += bp[i].rate;
         if (bp[i].operator_start)
             bp[i].operator_start(oldpop, bp[i].data);
     }
@@ -78,6 +156,7 @@ population* change_population(population* oldpop, breedphase* bp)
     if (elitism < 0)
         error(E_FATAL_ERROR, "elitism must be >= 0");
     
+    bind_tree_arena(newpop->arena);
     for (i = 0; i < elitism; i++)
     {
         /* select an individual... */
@@ -89,6 +168,7 @@ population* change_population(population* oldpop, breedphase* bp)
         ++newpop->next;
         printf("\tEliting a new pop!\n");
     }
+    bind_tree_arena(NULL);
     
     typedef struct
     {
@@ -100,28 +180,21 @@ population* change_population(population* oldpop, breedphase* bp)
     FREE(context->data);
     FREE(context);
     
-    /* now fill the new population. */
-    while (newpop->next < newpop->size)
-    {
-        
-        /** select an operator, either stochastically or not depending on
-          the probabilistic_operators parameter. **/
-        if (prob_oper)
-            r = totalrate * random_double(&globrand);
-        else
-            r = totalrate * ((double) newpop->next / (double) newpop->size);
-        
-        r2 = bp[1].rate;
-        for (i = 1; r2 < r;)
-            r2 += bp[++i].rate;
-#ifdef DEBUG
-        fprintf ( stderr, "picked %10.3lf; operator %d\n", r, i );
+    /* now fill the rest of the new population.  each worker breeds its
+   own slice, drawing from its own random stream and generation spaces. */
+    param.oldpop = oldpop;
+    param.newpop = newpop;
+    param.bp = bp;
+    param.first = newpop->next;
+    param.last = newpop->size;
+#ifdef POSIX_MT
+    param.slices = numthreads;
+    run_worker_pool(breed_chunk, &param);
+#else
+    param.slices = 1;
+    breed_chunk(0, &param);
 #endif
-        
-        /* call the phase's method to do the operation. */
-        if (bp[i].operator_operate)
-            bp[i].operator_operate(oldpop, newpop, bp[i].data);
-    }
+    newpop->next = newpop->size;
     
     /* call each phase's method to do cleanup. */
     for (i = 1; i <= numphases; ++i)
@@ -130,10 +203,10 @@ population* change_population(population* oldpop, breedphase* bp)
             bp[i].operator_end(bp[i].data);
     }
     
-    /* mark all the ERCs referenced in the new population. */
-    for (i = 0; i < newpop->size; ++i)
-        for (j = 0; j < tree_count; ++j)
-            reference_ephem_constants(newpop->ind[i].tr[j].data, 1);
+#ifdef TRACK_MEMORY
+    /* both generations are alive now, so this is when memory use peaks. */
+    sample_memory_stats();
+#endif
     
     /* free the old population. */
     free_population(oldpop);
@@ -42,8 +42,9 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
 {
      FILE *f;
      char *buffer;
-     ephem_const **eind;
+     DATATYPE *eind;
      int random_state_bytes;
+     int streams;
      int i;
      char *rand_state;
 
@@ -107,8 +108,24 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
      /* slurp the newline character following the hex data. */
      fgetc ( f );
 
-     /** skip the "section: parameter" line. **/
+     /** read the per-thread random streams, if the checkpoint has them. **/
      fgets ( buffer, MAXCHECKLINELENGTH, f );
+     if ( sscanf ( buffer, "random-streams: %d", &streams ) == 1 )
+     {
+          random_alloc_streams ( streams );
+          for ( i = 0; i < streams; ++i )
+          {
+               fscanf ( f, "%*s %d ", &random_state_bytes );
+               rand_state = (char *)MALLOC ( random_state_bytes+1 );
+               read_hex_block ( rand_state, random_state_bytes, f );
+               random_set_state ( random_stream ( i ), rand_state );
+               FREE ( rand_state );
+               fgetc ( f );
+          }
+          
+          /** skip the "section: parameter" line. **/
+          fgets ( buffer, MAXCHECKLINELENGTH, f );
+     }
 #ifdef DEBUG
      printf ( "should be parameter section: %s", buffer );
 #endif
@@ -125,7 +142,7 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
      printf ( "should be erc section: %s", buffer );
 #endif
      
-     /* read the list of ephemeral constants, and index them */
+     /* read the list of ephemeral constants, if an old checkpoint has one. */
      eind = read_ephem_list ( f );
 
      /** skip the "section: erc" line. **/
@@ -171,7 +188,8 @@ void read_checkpoint ( char *filename, int *gen, multipop **mpop )
      read_stats_checkpoint ( *mpop, eind, f );
 
      /* close'n'free. */
-     FREE ( eind );
+     if ( eind )
+          FREE ( eind );
      FREE ( buffer );
      fclose ( f );
      
@@ -190,7 +208,6 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
 
      FILE *f;
      unsigned char *rand_state;
-     ephem_index *eind;
      int i;
      int random_state_bytes;
      time_t now;
@@ -225,13 +242,25 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
      fputc ( '\n', f );
      FREE ( rand_state );
 
+     /** and of each per-thread stream. **/
+     fprintf ( f, "random-streams: %d\n", random_stream_count() );
+     for ( i = 0; i < random_stream_count(); ++i )
+     {
+          rand_state = random_get_state ( random_stream ( i ),
+                                         &random_state_bytes );
+          fprintf ( f, "random-state: %d ", random_state_bytes );
+          write_hex_block ( rand_state, random_state_bytes, f );
+          fputc ( '\n', f );
+          FREE ( rand_state );
+     }
+
      /** write the parameter database. **/
      fprintf ( f, "section: parameter\n" );
      write_parameter_database ( f );
 
-     /** write the list of ephemeral constants, and index them. **/
+     /** write the (empty) list of ephemeral constants. **/
      fprintf ( f, "section: erc\n" );
-     eind = write_ephem_list ( f );
+     write_ephem_list ( f );
 
      /** write the population. **/
      fprintf ( f, "section: population\n" );
@@ -239,7 +268,7 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
      for ( i = 0; i < mpop->size; ++i )
      {
 	  fprintf ( f, "subpop: %d\n", i );
-          write_population ( mpop->pop[i], eind, f );
+          write_population ( mpop->pop[i], f );
      }
      
      /** application-specific data. **/
@@ -248,15 +277,18 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
 
      /** statistics structures. **/
      fprintf ( f, "section: statistics\n" );
-     write_stats_checkpoint ( mpop, eind, f );
+     write_stats_checkpoint ( mpop, f );
 
      /** close'n'free. **/
-     FREE ( eind );
      fclose ( f );
 
      oprintf ( OUT_SYS, 20, "    population checkpointed: \"%s\".\n",
               filename );
 
+     /* get everything up to this point out to the output files, so that
+        if the process dies they agree with the checkpoint. */
+     sync_output_streams();
+
      /** do we compress the checkpoint file? **/
      param = get_parameter ( "checkpoint.compress" );
      if ( param )
@@ -322,7 +354,7 @@ void write_checkpoint ( int gen, multipop *mpop, char *filename )
  * in.
  */
 
-population *read_population ( ephem_const **eind, FILE *f )
+population *read_population ( DATATYPE *eind, FILE *f )
 {
      int i;
      char *buffer;
@@ -330,6 +362,9 @@ population *read_population ( ephem_const **eind, FILE *f )
 
      /* allocate. */
      pop = (population *)MALLOC ( sizeof ( population ) );
+     /* trees read from a checkpoint live on the heap. */
+     pop->arena = NULL;
+     pop->summary = NULL;
      /* read the "size" and "next" fields. */
      fscanf ( f, "%*s %d\n%*s %d\n", &(pop->size), &(pop->next) );
      /* allocate the individual array. */
@@ -355,13 +390,14 @@ population *read_population ( ephem_const **eind, FILE *f )
  * pointer.  it does NOT allocate the pointer.
  */
 
-void read_individual ( individual *ind, ephem_const **eind, FILE *f,
+void read_individual ( individual *ind, DATATYPE *eind, FILE *f,
 		      char *buffer )
 {
      int j, k[3];
 
      /* read the evald and flags fields. */
      fscanf ( f, "%d %d ", &(ind->evald), &(ind->flags) );
+     clear_lineage ( ind );
      if ( ind->evald == EVAL_CACHE_VALID )
      {
 	  /** if the individual has valid fitness values saved in the
@@ -427,12 +463,12 @@ void read_individual ( individual *ind, ephem_const **eind, FILE *f,
  * function to recursively read a tree from a checkpoint file.
  */
 
-void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
+void read_tree_recurse ( int space, DATATYPE *eind, FILE *fil, int tree,
 			char *string )
 {
      function *f;
      int i, j;
-     ephem_const *ep;
+     DATATYPE ep;
 
      /* read up until a nonwhitespace character in file.   the nonwhitespace
       character is saved in string[0]. */
@@ -460,8 +496,8 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 #endif
 
      /* look up the function name in this tree's function set.  if the
-	function is an ERC terminal (the name is of the form "name:ERCindex"),
-	then place the ERC address in ep. */
+	function is an ERC terminal (the name is of the form "name:#value"
+	or "name:ERCindex"), then place the ERC value in ep. */
      f = get_function_by_name ( tree, string, &ep, eind );
      /* add an lnode to the tree. */
      gensp_next(space)->f = f;
@@ -473,7 +509,7 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 	case EVAL_TERM:
 	  break;
 	case TERM_ERC:
-	  /* record the ERC address as the next lnode in the array. */
+	  /* record the ERC value as the next lnode in the array. */
 	  gensp_next(space)->d = ep;
 	  break;
 	case FUNC_DATA:
@@ -502,14 +538,16 @@ void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 /* get_function_by_name()
  *
  * looks up a function name in the function set for the given tree.  if
- * the function is an ERC, looks up the index (encoded in the name)
- * and stores the ERC address in ep.
+ * the function is an ERC, decodes the value (encoded in the name as
+ * "name:#hex"), or for older checkpoints looks up the index (encoded as
+ * "name:index") in eind, and stores the ERC value in ep.
  */
 
-function * get_function_by_name ( int tree, char *string, ephem_const **ep,
-				 ephem_const **eind )
+function * get_function_by_name ( int tree, char *string, DATATYPE *ep,
+				 DATATYPE *eind )
 {
-     int i, j, k;
+     int i, j = 0, k;
+     char *value = NULL;
      function_set *fs = fset+tree_map[tree].fset;
 
      k = strlen ( string );
@@ -517,10 +555,13 @@ function * get_function_by_name ( int tree, char *string, ephem_const **ep,
      {
 	  if ( string[i] == ':' )
 	  {
-	       /* names of the form "name:index" are chopped at the colon,
-		  and the value of the index saved. */
+	       /* names of the form "name:index" or "name:#hex" are chopped
+		  at the colon, and the index or value saved. */
 	       string[i] = 0;
-	       j = atoi ( string+i+1 );
+	       if ( string[i+1] == '#' )
+		    value = string+i+2;
+	       else
+		    j = atoi ( string+i+1 );
 	       break;
 	  }
 	  else if ( string[i] == ')' )
@@ -538,10 +579,15 @@ function * get_function_by_name ( int tree, char *string, ephem_const **ep,
 	  {
 	       if ( fs->cset[i].type == TERM_ERC )
 	       {
-		    /* if this is an ERC, lookup the saved index in the
-		       eind table, and store the looked-up address in ep. */
-		    *ep = eind[j];
-		    (*ep)->f = fs->cset+i;
+		    /* if this is an ERC, decode its value, or look up the
+		       saved index in the eind table. */
+		    if ( value )
+			 scan_hex_block ( ep, sizeof ( DATATYPE ), value );
+		    else if ( eind )
+			 *ep = eind[j];
+		    else
+			 error ( E_FATAL_ERROR, "ERC \"%s:%d\" has no value.",
+				 string, j );
 	       }
 	       /* return a pointer to the function. */
 	       return fs->cset+i;
@@ -556,7 +602,7 @@ function * get_function_by_name ( int tree, char *string, ephem_const **ep,
  * writes a population to a checkpoint file.
  */
 
-void write_population ( population *pop, ephem_index *eind, FILE *f )
+void write_population ( population *pop, FILE *f )
 {
      int i;
 
@@ -566,17 +612,16 @@ void write_population ( population *pop, ephem_index *eind, FILE *f )
      /* write each individual. */
      for ( i = 0; i < pop->size; ++i )
      {
-	  write_individual ( pop->ind+i, eind, f );
+	  write_individual ( pop->ind+i, f );
      }
 }
 
 /* write_individual()
  *
- * writes an individual to a checkpoint file.  uses eind to change ERC
- * addresses to integer indices.
+ * writes an individual to a checkpoint file.
  */
 
-void write_individual ( individual *ind, ephem_index *eind, FILE *f )
+void write_individual ( individual *ind, FILE *f )
 {
      int j;
      lnode *l;
@@ -610,7 +655,7 @@ void write_individual ( individual *ind, ephem_index *eind, FILE *f )
 
 	  /** write tree data. **/
 	  l = ind->tr[j].data;
-	  write_tree_recurse ( &l, eind, f );
+	  write_tree_recurse ( &l, f );
 	  fputc ( '\n', f );
      }
 }
@@ -619,11 +664,10 @@ void write_individual ( individual *ind, ephem_index *eind, FILE *f )
  *
  * function to recursively write trees to a checkpoint file.  the same
  * as print_tree_recurse(), except that ERC nodes are written as
- * "name:index" rather than the value, using eind to translate addresses
- * to indices.
+ * "name:#hex", the value as a hex block, so no precision is lost.
  */
 
-void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
+void write_tree_recurse ( lnode **l, FILE *fil )
 {
      function *f;
      int i;
@@ -639,9 +683,9 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
      ++*l;
      if ( f->type == TERM_ERC )
      {
-	  /* ERCs printed as "name:index". */
-	  fprintf ( fil, "%s:%d", f->string,
-		   lookup_ephem ( eind, (**l).d ) );
+	  /* ERCs printed as "name:#hex". */
+	  fprintf ( fil, "%s:#", f->string );
+	  write_hex_block ( &((**l).d), sizeof ( DATATYPE ), fil );
           ++*l;
      }
      else
@@ -654,7 +698,7 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
         case EVAL_DATA:
 	  /** recursively print children. **/
           for ( i = 0; i < f->arity; ++i )
-               write_tree_recurse ( l, eind, fil );
+               write_tree_recurse ( l, fil );
           break;
         case FUNC_EXPR:
         case EVAL_EXPR:
@@ -662,7 +706,7 @@ void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil )
           for ( i = 0; i < f->arity; ++i )
           {
                ++*l;
-               write_tree_recurse ( l, eind, fil );
+               write_tree_recurse ( l, fil );
           }
           break;
      }
@@ -710,5 +754,30 @@ void read_hex_block ( void *buf, int n, FILE *f )
      }
 }
 
+/* scan_hex_block()
+ *
+ * the same as read_hex_block(), reading the hex characters from a
+ * string.
+ */
+
+void scan_hex_block ( void *buf, int n, char *s )
+{
+     int i;
+     unsigned char *b = (unsigned char *)buf;
+     int c[2] = { 0, 0 };
+     
+     for ( i = 0; i < n; ++i )
+     {
+	  c[0] = *s++;
+	  c[1] = *s++;
+	  
+	  /* convert hex chars to base 10. */
+	  c[0] = c[0]>'9' ? c[0]-'a'+10 : c[0]-'0';
+	  c[1] = c[1]>'9' ? c[1]-'a'+10 : c[1]-'0';
+	  
+	  b[i] = c[0] * 16 + c[1];
+     }
+}
+
 	  
 	  
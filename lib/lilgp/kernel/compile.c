@@ -0,0 +1,226 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+
+/* compiled trees.  compile_tree() turns a tree into straight-line code
+ * for a small register machine:  one instruction per node, in the order
+ * the nodes have to be computed, each naming the register it writes and
+ * the registers holding its arguments.  running it is a single loop over
+ * the instructions with no recursion, no lnode walking and no switch on
+ * the node type, which pays off for a tree that is run over and over,
+ * such as the best of run being scored on the test set.
+ *
+ * registers are handed out like a stack:  a node computed into register r
+ * has its arguments in r, r+1, ...  so the register count is bounded by
+ * the tree depth plus the widest arity.  only trees whose nodes are all
+ * FUNC_DATA, TERM_NORM or TERM_ERC can be compiled.  a compiled tree
+ * carries its own registers, so it must only be run by one thread at a
+ * time.
+ */
+
+typedef struct
+{
+     function *f;              /* NULL loads the constant d */
+     DATATYPE d;
+     int dst;                  /* register written; arguments follow it */
+} tree_op;
+
+struct _compiled_tree
+{
+     int whichtree;
+     tree_op *op;
+     int ops;
+     int registers;
+
+     DATATYPE *value;          /* registers for evaluate_compiled() */
+     DATATYPE *column;         /* registers for evaluate_compiled_batch() */
+     int stride;               /* doubles per column register */
+};
+
+/* compile_recurse()
+ *
+ * emits the code for the subtree at *l into register r.  returns 0 if the
+ * subtree holds a node that cannot be compiled.
+ */
+
+static int compile_recurse ( lnode **l, compiled_tree *c, int r )
+{
+     function *f = (**l).f;
+     tree_op *op;
+     int i;
+
+     ++*l;
+     switch ( f->type )
+     {
+        case FUNC_DATA:
+          for ( i = 0; i < f->arity; ++i )
+               if ( !compile_recurse ( l, c, r+i ) )
+                    return 0;
+          break;
+        case TERM_NORM:
+        case TERM_ERC:
+          break;
+        default:
+          return 0;
+     }
+
+     op = c->op + c->ops++;
+     op->dst = r;
+     if ( f->type == TERM_ERC )
+     {
+          op->f = NULL;
+          op->d = (*((*l)++)).d;
+     }
+     else
+     {
+          op->f = f;
+          op->d = 0.0;
+     }
+
+     if ( r + ( f->arity ? f->arity : 1 ) > c->registers )
+          c->registers = r + ( f->arity ? f->arity : 1 );
+     return 1;
+}
+
+/* compile_tree()
+ *
+ * compiles a tree.  returns NULL if it holds a node type that cannot be
+ * compiled.
+ */
+
+compiled_tree *compile_tree ( lnode *tree, int whichtree )
+{
+     compiled_tree *c;
+     lnode *l = tree;
+
+     c = (compiled_tree *)MALLOC ( sizeof ( compiled_tree ) );
+     c->whichtree = whichtree;
+     c->ops = 0;
+     c->registers = 1;
+     c->op = (tree_op *)MALLOC ( tree_nodes ( tree ) * sizeof ( tree_op ) );
+     c->value = NULL;
+     c->column = NULL;
+     c->stride = 0;
+
+     if ( !compile_recurse ( &l, c, 0 ) )
+     {
+          free_compiled_tree ( c );
+          return NULL;
+     }
+
+     c->value = (DATATYPE *)MALLOC ( c->registers * sizeof ( DATATYPE ) );
+     return c;
+}
+
+/* free_compiled_tree()
+ *
+ * frees a compiled tree.
+ */
+
+void free_compiled_tree ( compiled_tree *c )
+{
+     if ( c == NULL )
+          return;
+     if ( c->value )
+          FREE ( c->value );
+     if ( c->column )
+          FREE ( c->column );
+     FREE ( c->op );
+     FREE ( c );
+}
+
+/* evaluate_compiled()
+ *
+ * runs a compiled tree for the current fitness case, calling the code of
+ * each node just as evaluate_tree() would.
+ */
+
+DATATYPE evaluate_compiled ( compiled_tree *c )
+{
+     farg arg[MAXARGS];
+     DATATYPE *v = c->value;
+     tree_op *op, *end = c->op + c->ops;
+     int i;
+
+     for ( op = c->op; op < end; ++op )
+     {
+          if ( op->f == NULL )
+               v[op->dst] = op->d;
+          else if ( op->f->arity == 0 )
+               v[op->dst] = (op->f->code)(c->whichtree, NULL);
+          else
+          {
+               for ( i = 0; i < op->f->arity; ++i )
+                    arg[i].d = v[op->dst+i];
+               v[op->dst] = (op->f->code)(c->whichtree, arg);
+          }
+     }
+
+     return v[0];
+}
+
+/* evaluate_compiled_batch()
+ *
+ * runs a compiled tree over a block of fitness cases, calling the vcode
+ * of each node with whole columns just as evaluate_tree_batch() would.
+ * the results are left in out[0..b->count-1].
+ */
+
+void evaluate_compiled_batch ( compiled_tree *c, batchinfo *b,
+                               DATATYPE *out )
+{
+     DATATYPE *arg[MAXARGS];
+     DATATYPE *dst;
+     tree_op *op, *end = c->op + c->ops;
+     int i;
+
+     if ( b->count > c->stride )
+     {
+          if ( c->column )
+               FREE ( c->column );
+          c->stride = b->count;
+          c->column = (DATATYPE *)MALLOC ( c->registers * c->stride *
+                                           sizeof ( DATATYPE ) );
+     }
+
+     for ( op = c->op; op < end; ++op )
+     {
+	  /* the root's value goes straight to out. */
+          dst = op->dst ? c->column + op->dst * c->stride : out;
+          if ( op->f == NULL )
+               for ( i = 0; i < b->count; ++i )
+                    dst[i] = op->d;
+          else
+          {
+               arg[0] = dst;
+               for ( i = 1; i < op->f->arity; ++i )
+                    arg[i] = c->column + ( op->dst + i ) * c->stride;
+               (op->f->vcode)(c->whichtree, b, dst, arg);
+          }
+     }
+}
@@ -35,7 +35,9 @@ typedef struct
      double external;
      double *tree;       /* probability that a given tree
 			    will be selected for crossover. */
-     double *treecumul;  /* running sum of "tree" field. */
+     double *treecumul;  /* running sum of "tree" field, zeroing trees
+                            outside the function set; one row of
+                            tree_count entries per function set. */
      double treetotal;   /* total of all tree fields. */
      double *func;       /* probability that a given function
 			    set will be selected for crossover. */
@@ -79,7 +81,8 @@ int operator_crossover_init ( char *options, breedphase *bp )
      cd->internal = 0.9;
      cd->external = 0.1;
      cd->tree = (double *)MALLOC ( tree_count * sizeof ( double ) );
-     cd->treecumul = (double *)MALLOC ( tree_count * sizeof ( double ) );
+     cd->treecumul = (double *)MALLOC ( fset_count * tree_count *
+                                       sizeof ( double ) );
      for ( j = 0; j < tree_count; ++j )
           cd->tree[j] = 0.0;
      cd->treetotal = 0.0;
@@ -262,6 +265,20 @@ int operator_crossover_init ( char *options, breedphase *bp )
      for ( j = 0; j < fset_count; ++j )
           r = (cd->func[j] += r);
 
+     /* fill in the "treecumul" rows.  these never change, so breeding
+	threads can all read them at once. */
+     for ( k = 0; k < fset_count; ++k )
+     {
+          r = 0.0;
+          for ( j = 0; j < tree_count; ++j )
+          {
+               if ( tree_map[j].fset == k )
+                    r = (cd->treecumul[k*tree_count+j] = r + cd->tree[j]);
+               else
+                    cd->treecumul[k*tree_count+j] = r;
+          }
+     }
+
 #ifdef DEBUG
      if ( !errors )
      {
@@ -366,38 +383,30 @@ void operator_crossover ( population *oldpop, population *newpop,
      int badtree1, badtree2;
      double total;
      int forceany1, forceany2;
-     int repcount;
-     int f, t1, t2, j;
+     int f, t1, t2;
      double r, r2;
      int totalnodes1, totalnodes2;
      int i;
      int count=0;     /* Number of attempts */
+     double *treecumul;
 
      /* get the crossover-specific data structure. */
      cd = (crossover_data *)data;
      total = cd->internal + cd->external;
 
      /* choose a function set. */
-     r = random_double(&globrand) * cd->treetotal;
+     r = random_double(get_randomgen()) * cd->treetotal;
      for ( f = 0; r >= cd->func[f]; ++f );
 
-     /* fill in the "treecumul" array, zeroing all trees which
-	don't use the selected function set. */
-     r = 0.0;
-     t1 = 0;
-     for ( j = 0; j < tree_count; ++j )
-     {
-          if ( tree_map[j].fset == f )
-               r = (cd->treecumul[j] = r + cd->tree[j]);
-          else
-               cd->treecumul[j] = r;
-     }
+     /* look up the "treecumul" row for the selected function set. */
+     treecumul = cd->treecumul + f*tree_count;
+     r = treecumul[tree_count-1];
 
      /* select the first and second trees. */
-     r2 = random_double(&globrand) * r;
-     for ( t1 = 0; r2 >= cd->treecumul[t1]; ++t1 );
-     r2 = random_double(&globrand) * r;
-     for ( t2 = 0; r2 >= cd->treecumul[t2]; ++t2 );
+     r2 = random_double(get_randomgen()) * r;
+     for ( t1 = 0; r2 >= treecumul[t1]; ++t1 );
+     r2 = random_double(get_randomgen()) * r;
+     for ( t2 = 0; r2 >= treecumul[t2]; ++t2 );
 
 #ifdef DEBUG_CROSSOVER
      printf ( "selected function set %d --> t1: %d; t2: %d\n", f, t1, t2 );
@@ -432,44 +441,44 @@ void operator_crossover ( population *oldpop, population *newpop,
           if ( forceany1 )
           {
 	       /* choose any point. */
-               l1 = random_int ( &globrand, ps1 );
-               st[1] = get_subtree ( oldpop->ind[p1].tr[t1].data, l1 );
+               l1 = random_int ( get_randomgen(), ps1 );
+               st[1] = tree_point ( oldpop->ind[p1].tr+t1, l1 );
 	      /* print_tree(st[1],stdout);*/
           }
-          else if ( total*random_double(&globrand) < cd->internal )
+          else if ( total*random_double(get_randomgen()) < cd->internal )
           {
 	       /* choose an internal point. */
-               l1 = random_int ( &globrand, tree_nodes_internal (oldpop->ind[p1].tr[t1].data) );
-               st[1] = get_subtree_internal ( oldpop->ind[p1].tr[t1].data, l1 );
+               l1 = random_int ( get_randomgen(), oldpop->ind[p1].tr[t1].internal );
+               st[1] = tree_point_internal ( oldpop->ind[p1].tr+t1, l1 );
 	       /*print_tree(st[1],stdout);*/
           }
           else
           {
 	       /* choose an external point. */
-               l1 = random_int ( &globrand, tree_nodes_external (oldpop->ind[p1].tr[t1].data) );
-               st[1] = get_subtree_external ( oldpop->ind[p1].tr[t1].data, l1 );
+               l1 = random_int ( get_randomgen(), ps1 - oldpop->ind[p1].tr[t1].internal );
+               st[1] = tree_point_external ( oldpop->ind[p1].tr+t1, l1 );
 	       /*print_tree(st[1],stdout);*/
           }
                                 
           if ( forceany2 )
           {
 	       /* choose any point on second parent. */
-               l2 = random_int ( &globrand, ps2 );
-               st[2] = get_subtree ( oldpop->ind[p2].tr[t2].data, l2 );
+               l2 = random_int ( get_randomgen(), ps2 );
+               st[2] = tree_point ( oldpop->ind[p2].tr+t2, l2 );
 	       /*print_tree(st[2],stdout);*/
           }
-          else if ( total*random_double(&globrand) < cd->internal )
+          else if ( total*random_double(get_randomgen()) < cd->internal )
           {
 	       /* choose internal point. */
-               l2 = random_int ( &globrand, tree_nodes_internal (oldpop->ind[p2].tr[t2].data) );
-               st[2] = get_subtree_internal ( oldpop->ind[p2].tr[t2].data, l2 );
+               l2 = random_int ( get_randomgen(), oldpop->ind[p2].tr[t2].internal );
+               st[2] = tree_point_internal ( oldpop->ind[p2].tr+t2, l2 );
 	       /*print_tree(st[2],stdout);*/
           }
           else
           {
 	       /* choose external point. */
-               l2 = random_int ( &globrand, tree_nodes_external (oldpop->ind[p2].tr[t2].data) );
-               st[2] = get_subtree_external ( oldpop->ind[p2].tr[t2].data, l2 );
+               l2 = random_int ( get_randomgen(), ps2 - oldpop->ind[p2].tr[t2].internal );
+               st[2] = tree_point_external ( oldpop->ind[p2].tr+t2, l2 );
 	       /*print_tree(st[2],stdout);*/
           }
 
@@ -498,8 +507,8 @@ void operator_crossover ( population *oldpop, population *newpop,
 #endif
 
 	  /* count the nodes in the selected subtrees. */
-          sts1 = tree_nodes ( st[1] );
-          sts2 = tree_nodes ( st[2] );
+          sts1 = point_nodes ( oldpop->ind[p1].tr+t1, st[1] );
+          sts2 = point_nodes ( oldpop->ind[p2].tr+t2, st[2] );
 
 	  /* calculate the sizes of the offspring. */
           ns1 = ps1 - sts1 + sts2;
@@ -521,8 +530,8 @@ void operator_crossover ( population *oldpop, population *newpop,
                badtree1 |= 1;
           else if ( tree_map[t1].depthlimit > -1 )
           {
-               ns1 = tree_depth_to_subtree ( oldpop->ind[p1].tr[t1].data, st[1] ) +
-                     tree_depth ( st[2] );
+               ns1 = point_level ( oldpop->ind[p1].tr+t1, st[1] ) +
+                     point_depth ( oldpop->ind[p2].tr+t2, st[2] );
 #ifdef DEBUG_CROSSOVER
                printf ( "newtree 1 has depth %d; limit is %d\n",
                        ns1, tree_map[t1].depthlimit );
@@ -546,8 +555,8 @@ void operator_crossover ( population *oldpop, population *newpop,
                badtree2 |= 1;
           else if ( tree_map[t2].depthlimit > -1 )
           {
-               ns2 = tree_depth_to_subtree ( oldpop->ind[p2].tr[t2].data, st[2] ) +
-                     tree_depth ( st[1] );
+               ns2 = point_level ( oldpop->ind[p2].tr+t2, st[2] ) +
+                     point_depth ( oldpop->ind[p1].tr+t1, st[1] );
                if ( ns2 > tree_map[t2].depthlimit )
                     badtree2 |= 1;
           }
@@ -586,9 +595,6 @@ void operator_crossover ( population *oldpop, population *newpop,
 	      cd->num_times > count))
                continue;
           
-          /* copy the first parent to the first offspring position */
-          duplicate_individual ( newpop->ind+newpop->next,
-                                oldpop->ind+p1 );
           if ( !badtree1 )
           {
 	       /* if the first offspring is allowable... */
@@ -596,22 +602,23 @@ void operator_crossover ( population *oldpop, population *newpop,
 #ifdef DEBUG_CROSSOVER
                fprintf ( stderr, "offspring 1 is allowable.\n" );
 #endif
+
+	       /* copy the first parent to the first offspring position,
+		  all but the tree being crossed over. */
+               duplicate_individual_except ( newpop->ind+newpop->next,
+                                            oldpop->ind+p1, t1 );
 	       
 	       /* make a copy of the crossover tree, replacing the
 		  selected subtree with the crossed-over subtree. */
-               copy_tree_replace_many ( 0, oldpop->ind[p1].tr[t1].data,
-                                       st+1, st+2, 1, &repcount );
-               if ( repcount != 1 )
-               {
-		    /* this can't happen, but check anyway. */
-                    error ( E_FATAL_ERROR,
-                           "botched crossover:  this can't happen" );
-               }
+               splice_tree ( 0, oldpop->ind[p1].tr+t1, t1, st[1], st[2],
+                             point_size ( oldpop->ind[p2].tr+t2, st[2] ) );
 
-               /* free the appropriate tree of the new individual */
-               free_tree ( newpop->ind[newpop->next].tr+t1 );
-               /* copy the crossovered tree to the freed space */
+               /* copy the crossovered tree to the empty slot */
                gensp_dup_tree ( 0, newpop->ind[newpop->next].tr+t1 );
+               splice_lineage ( newpop->ind+newpop->next,
+                                st[1] - oldpop->ind[p1].tr[t1].data,
+                                point_size ( oldpop->ind[p1].tr+t1, st[1] ),
+                                point_size ( oldpop->ind[p2].tr+t2, st[2] ) );
 
 	       /* the new individual's fitness fields are of course invalid. */
                newpop->ind[newpop->next].evald = EVAL_CACHE_INVALID;
@@ -619,11 +626,13 @@ void operator_crossover ( population *oldpop, population *newpop,
           }
           else
           {
-	       /* offspring too big but keep_trying not set, just leave the copied
-		  parent 1 in the offspring position. */
+	       /* offspring too big but keep_trying not set, just copy
+		  parent 1 to the offspring position. */
 #ifdef DEBUG_CROSSOVER
                fprintf ( stderr, "offspring 1 is too big; copying parent 1.\n" );
 #endif
+               duplicate_individual ( newpop->ind+newpop->next,
+                                     oldpop->ind+p1 );
           }
 
 	  /* we've just filled in one member of the new population. */
@@ -641,40 +650,41 @@ void operator_crossover ( population *oldpop, population *newpop,
 	  /* if the new population needs another member (it's not full) */
           if ( newpop->next < newpop->size )
           {
-	       /* copy the second parent to the second offspring position. */
-               duplicate_individual ( newpop->ind+newpop->next,
-                                     oldpop->ind+p2 );
                if ( !badtree2 )
                {
 		    /* if the second offspring is allowable... */
 #ifdef DEBUG_CROSSOVER
                     fprintf ( stderr, "offspring 2 is allowable.\n" );
 #endif
+		    /* copy the second parent to the second offspring
+		       position, all but the tree being crossed over. */
+                    duplicate_individual_except ( newpop->ind+newpop->next,
+                                                 oldpop->ind+p2, t2 );
 		    /* then make a copy of the tree, replacing the crossover
 		       subtree. */
-                    copy_tree_replace_many ( 0, oldpop->ind[p2].tr[t2].data,
-                                            st+2, st+1, 1, &repcount );
-                    if ( repcount != 1 )
-                    {
-                         error ( E_FATAL_ERROR,
-                                "bad crossover:  this can't happen" );
-                    }
+                    splice_tree ( 0, oldpop->ind[p2].tr+t2, t2, st[2], st[1],
+                                  point_size ( oldpop->ind[p1].tr+t1, st[1] ) );
 
-		    /* free the old tree in the new individual, and replace
-		       it with the crossover tree. */
-                    free_tree ( newpop->ind[newpop->next].tr+t2 );
+		    /* fill the empty tree in the new individual with the
+		       crossover tree. */
                     gensp_dup_tree ( 0, newpop->ind[newpop->next].tr+t2 );
+                    splice_lineage ( newpop->ind+newpop->next,
+                                     st[2] - oldpop->ind[p2].tr[t2].data,
+                                     point_size ( oldpop->ind[p2].tr+t2, st[2] ),
+                                     point_size ( oldpop->ind[p1].tr+t1, st[1] ) );
                     
                     newpop->ind[newpop->next].evald = EVAL_CACHE_INVALID;
                     newpop->ind[newpop->next].flags = FLAG_NONE;
                }
                else
                {
-		    /* offspring too big but keep_trying not set; just leave
-		       the copy of parent 2 where it is. */
+		    /* offspring too big but keep_trying not set; just copy
+		       parent 2 to the offspring position. */
 #ifdef DEBUG_CROSSOVER
                     fprintf ( stderr, "offspring 2 is big; copying parent 2.\n" );
 #endif
+                    duplicate_individual ( newpop->ind+newpop->next,
+                                          oldpop->ind+p2 );
                }
                
                ++newpop->next;
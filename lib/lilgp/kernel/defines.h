@@ -28,8 +28,13 @@
 #ifndef _DEFINES_H
 #define _DEFINES_H
 
-/* remove this #define to turn off memory tracking. */
+/* memory tracking counts every MALLOC(), REALLOC() and FREE() for the
+   statistics at the end of the run.  it is on unless the build defines
+   NO_TRACK_MEMORY (the ENABLE_MEMORY_TRACKING cmake option), in which case
+   those macros are plain malloc(), realloc() and free(). */
+#ifndef NO_TRACK_MEMORY
 #define TRACK_MEMORY
+#endif
 
 /* define this to write a file "memory.log" with a record of all MALLOC()s,
    REALLOC()s, and FREE()s.  useful for debugging and finding memory leaks. */
@@ -40,9 +45,6 @@
 /*#define RANDOMSEEDTIME*/
 
 #define EXTRAMEM              8
-#define EPHEM_METABLOCKSIZE   10
-#define EPHEM_STARTSIZE       1000
-#define EPHEM_GROWSIZE        500
 
 #define MAXPARAMLINELENGTH    255
 #define MAXCHECKLINELENGTH    255
@@ -91,7 +93,9 @@
 #define OUT_STT    3
 #define OUT_BST    4
 #define OUT_HIS    5
-#define OUT_USER   6
+#define OUT_TIM    6
+#define OUT_STB    7
+#define OUT_USER   8
 
 #define PARAM_COPY_NONE   0
 #define PARAM_COPY_NAME   1
@@ -99,7 +103,10 @@
 
 #define MAXMESSAGELENGTH 4096
 #define MAXOUTPUTSTREAMS 25
-#define SYSOUTPUTSTREAMS 6
+#define SYSOUTPUTSTREAMS 8
+
+#define STB_MAGIC        "lilgpstb"
+#define STB_VERSION      1
 
 #define PARAMETER_MINSIZE       31
 #define PARAMETER_CHUNKSIZE     16
@@ -110,10 +117,24 @@
 
 #define FLAG_NONE               0
 #define FLAG_NEWEXCH            1
+/* evaluation stopped early; the fitness is only a bound on the real one. */
+#define FLAG_BOUNDED            2
 
 #define GENSPACE_COUNT          2
 
+/* byte alignment of the batch evaluator's scratch columns. */
+#define BATCH_ALIGN             64
+
+/* results of memo_lookup(). */
+#define MEMO_MISS               0
+#define MEMO_HIT                1
+#define MEMO_ADMIT              2
+
+/* lnodes in each block of a population's tree arena. */
+#define ARENA_BLOCK             16384
+
 #define GENSPACE_START          100
+/* genspaces double in size when full, growing by at least this much. */
 #define GENSPACE_GROW           100
 
 #define CK_MAGIC                "lilgp1.0\n"
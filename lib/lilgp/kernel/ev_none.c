@@ -42,6 +42,11 @@ char *event_string ( event *z )
      return string;
 }
 
+long long event_nsec ( event *z )
+{
+     return 0;
+}
+
 void event_zero ( event *z )
 {
 }
@@ -35,6 +35,7 @@ typedef struct
 void event_init ( void );
 void event_mark ( event *e );
 char *event_string ( event *z );
+long long event_nsec ( event *z );
 void event_zero ( event *z );
 void event_diff ( event *z, event *one, event *two );
 void event_accum ( event *z, event *one );
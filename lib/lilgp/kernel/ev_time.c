@@ -47,6 +47,11 @@ char *event_string ( event *z )
      return string;
 }
 
+long long event_nsec ( event *z )
+{
+     return z->wall * 1000000000LL;
+}
+
 void event_zero ( event *z )
 {
      z->wall = 0;
@@ -56,6 +56,11 @@ char *event_string ( event *z )
      return string;
 }
 
+long long event_nsec ( event *z )
+{
+     return (long long)z->wall * 1000000000LL / tickspersec;
+}
+
 void event_zero ( event *z )
 {
      z->wall = z->user = z->sys = 0;
@@ -55,6 +55,57 @@ void set_current_individual ( individual *ind )
   CURRENT_INDIVIDUAL = ind;
 }
 
+/* which trees evaluate_tree() hands to evaluate_tree_stack(), or NULL if
+   the stack evaluator is off. */
+static char *stack_tree = NULL;
+
+/* initialize_evaluation()
+ *
+ * reads the "eval.stack" parameter.  when it is set, trees whose function
+ * set holds only FUNC_DATA, TERM_NORM and TERM_ERC nodes are evaluated by
+ * evaluate_tree_stack() instead of the recursive evaluator.  must be
+ * called after the function sets are built.
+ */
+
+void initialize_evaluation ( void )
+{
+     function *f;
+     int i, j, n = 0;
+
+     if ( !atoi ( get_parameter ( "eval.stack" ) ) )
+          return;
+
+     stack_tree = (char *)MALLOC ( tree_count );
+     for ( j = 0; j < tree_count; ++j )
+     {
+          stack_tree[j] = 1;
+          for ( i = 0; i < fset[tree_map[j].fset].size; ++i )
+          {
+               f = fset[tree_map[j].fset].cset + i;
+               if ( f->type != FUNC_DATA && f->type != TERM_NORM &&
+                    f->type != TERM_ERC )
+                    stack_tree[j] = 0;
+          }
+          n += stack_tree[j];
+     }
+
+     oprintf ( OUT_SYS, 30, "    stack evaluation of %d of %d tree(s).\n",
+               n, tree_count );
+}
+
+/* free_evaluation()
+ *
+ * frees what initialize_evaluation() set up.
+ */
+
+void free_evaluation ( void )
+{
+     if ( stack_tree )
+          FREE ( stack_tree );
+     stack_tree = NULL;
+}
+
+
 
 
 
@@ -74,6 +125,8 @@ DATATYPE evaluate_tree ( lnode *tree, int whichtree )
 #ifdef DEBUG_EVAL
      printf ( "call to evaluate_tree in context %d\n", whichtree );
 #endif
+     if ( stack_tree && stack_tree[whichtree] )
+          return evaluate_tree_stack ( tree, whichtree );
      return evaluate_tree_recurse ( &l, whichtree );
 }
 
@@ -207,7 +260,7 @@ DATATYPE evaluate_tree_recurse ( lnode **l, int whichtree )
         case TERM_ERC:
 	  /* ERC terminal:  traversal pointer points to ERC structure.
 	     pull the value out, and step the pointer forward. */
-          return (*((*l)++)).d->d;
+          return (*((*l)++)).d;
           break;
         default: /* TERM_NORM */
 	  /* normal terminal:  just call the user code. */
@@ -218,3 +271,497 @@ DATATYPE evaluate_tree_recurse ( lnode **l, int whichtree )
 
 
 
+
+/* a function waiting in evaluate_tree_stack() for the values of its
+   arguments, the first of which is at position base of the value stack. */
+
+typedef struct
+{
+     function *f;
+     int base;
+} stackframe;
+
+/* the batch evaluator needs scratch columns to hold the values of
+   function arguments while their siblings are being evaluated.  each
+   thread gets its own set, grown as needed and kept between calls. */
+
+typedef struct
+{
+     DATATYPE *base;      /* block as returned by MALLOC */
+     DATATYPE *column;    /* first column, aligned to BATCH_ALIGN bytes */
+     int columns;
+     int stride;          /* doubles from one column to the next */
+
+     /* per-subtree hashes, lengths and memo eligibility of the tree
+	being evaluated, when the subtree memo or spines are on. */
+     lnode *tree;
+     unsigned long long *hash;
+     int *span;
+     char *worth;
+     int lnodes;          /* capacity of the three arrays */
+
+     /* how the current tree uses the memo and spines. */
+     int memo;
+     int depth;           /* levels covered by spines, 0 if none */
+     spine *rec;          /* spine being filled in, or NULL */
+     spine *from;         /* the parent's spine, or NULL */
+     int edit, shift;     /* where the parent's spine lines up */
+
+     /* the value and function stacks of evaluate_tree_stack(). */
+     DATATYPE *value;
+     stackframe *frame;
+     int stackdepth;      /* capacity of both */
+} batchspace;
+
+#if !defined(POSIX_MT) && !defined(SOLARIS_MT)
+
+static batchspace batch_ws;
+
+static batchspace *get_batchspace ( void )
+{
+     return &batch_ws;
+}
+
+#else
+
+#include <pthread.h>
+
+static pthread_key_t batch_key;
+static pthread_once_t batch_once = PTHREAD_ONCE_INIT;
+static _Thread_local batchspace *my_ws = NULL;
+
+static void free_batchspace ( void *p )
+{
+     batchspace *ws = (batchspace *)p;
+     if ( ws->base )
+          FREE ( ws->base );
+     if ( ws->hash )
+     {
+          FREE ( ws->hash );
+          FREE ( ws->span );
+          FREE ( ws->worth );
+     }
+     if ( ws->value )
+     {
+          FREE ( ws->value );
+          FREE ( ws->frame );
+     }
+     FREE ( ws );
+}
+
+static void create_batch_key ( void )
+{
+     pthread_key_create ( &batch_key, free_batchspace );
+}
+
+static batchspace *get_batchspace ( void )
+{
+     batchspace *ws;
+
+     if ( my_ws )
+          return my_ws;
+     pthread_once ( &batch_once, create_batch_key );
+     ws = (batchspace *)pthread_getspecific ( batch_key );
+     if ( ws == NULL )
+     {
+          ws = (batchspace *)MALLOC ( sizeof ( batchspace ) );
+          ws->base = NULL;
+          ws->column = NULL;
+          ws->columns = 0;
+          ws->stride = 0;
+          ws->tree = NULL;
+          ws->hash = NULL;
+          ws->span = NULL;
+          ws->worth = NULL;
+          ws->lnodes = 0;
+          ws->rec = ws->from = NULL;
+          ws->value = NULL;
+          ws->frame = NULL;
+          ws->stackdepth = 0;
+          pthread_setspecific ( batch_key, ws );
+     }
+     my_ws = ws;
+     return ws;
+}
+
+#endif
+
+/* reserve_batchspace()
+ *
+ * makes sure the scratch space holds at least "columns" columns of
+ * "count" values each.  columns are padded so each one starts on a
+ * BATCH_ALIGN byte boundary, which lets the vectorized function code use
+ * aligned loads.
+ */
+
+static void reserve_batchspace ( batchspace *ws, int columns, int count )
+{
+     int per = BATCH_ALIGN / sizeof ( DATATYPE );
+     int stride = ( ( count + per - 1 ) / per ) * per;
+     unsigned long addr;
+
+     if ( columns <= ws->columns && stride <= ws->stride )
+          return;
+
+     if ( columns < ws->columns )
+          columns = ws->columns;
+     if ( stride < ws->stride )
+          stride = ws->stride;
+
+     if ( ws->base )
+          FREE ( ws->base );
+     ws->base = (DATATYPE *)MALLOC ( columns * stride * sizeof ( DATATYPE ) +
+                                    BATCH_ALIGN );
+     addr = (unsigned long)ws->base;
+     addr = ( addr + BATCH_ALIGN - 1 ) & ~(unsigned long)( BATCH_ALIGN - 1 );
+     ws->column = (DATATYPE *)addr;
+     ws->columns = columns;
+     ws->stride = stride;
+}
+
+/* grow_stack()
+ *
+ * doubles the stacks of evaluate_tree_stack().
+ */
+
+static void grow_stack ( batchspace *ws )
+{
+     ws->stackdepth = ws->stackdepth ? ws->stackdepth * 2 : 64;
+     if ( ws->value )
+     {
+          ws->value = (DATATYPE *)REALLOC ( ws->value, ws->stackdepth *
+                                            sizeof ( DATATYPE ) );
+          ws->frame = (stackframe *)REALLOC ( ws->frame, ws->stackdepth *
+                                              sizeof ( stackframe ) );
+     }
+     else
+     {
+          ws->value = (DATATYPE *)MALLOC ( ws->stackdepth *
+                                           sizeof ( DATATYPE ) );
+          ws->frame = (stackframe *)MALLOC ( ws->stackdepth *
+                                             sizeof ( stackframe ) );
+     }
+}
+
+/* evaluate_tree_stack()
+ *
+ * evaluates a tree of FUNC_DATA, TERM_NORM and TERM_ERC nodes in a single
+ * pass over its lnodes, without recursion.  a function node is pushed on
+ * the function stack; a terminal's value completes every function it is
+ * the last argument of, innermost first, and whatever is left is pushed
+ * on the value stack as an argument of the function on top.  the stacks
+ * are per thread and grow as needed, so the depth of a tree is limited
+ * only by memory.  the user code is called exactly as evaluate_tree()
+ * would call it, in the same order.
+ */
+
+DATATYPE evaluate_tree_stack ( lnode *tree, int whichtree )
+{
+     batchspace *ws = get_batchspace();
+     farg arg[MAXARGS];
+     lnode *l = tree;
+     function *f;
+     stackframe *top;
+     DATATYPE v;
+     int sp = 0, fp = 0, i;
+
+     for ( ;; )
+     {
+          f = (l++)->f;
+          if ( f->arity > 0 )
+          {
+               if ( fp == ws->stackdepth )
+                    grow_stack ( ws );
+               ws->frame[fp].f = f;
+               ws->frame[fp].base = sp;
+               ++fp;
+               continue;
+          }
+
+          if ( f->type == TERM_ERC )
+               v = (l++)->d;
+          else
+               v = (f->code)(whichtree, NULL);
+
+          while ( fp > 0 &&
+                  sp - ws->frame[fp-1].base == ws->frame[fp-1].f->arity - 1 )
+          {
+               top = ws->frame + --fp;
+               for ( i = 0; i < top->f->arity - 1; ++i )
+                    arg[i].d = ws->value[top->base+i];
+               arg[i].d = v;
+               v = (top->f->code)(whichtree, arg);
+               sp = top->base;
+          }
+
+          if ( fp == 0 )
+               return v;
+          if ( sp == ws->stackdepth )
+               grow_stack ( ws );
+          ws->value[sp++] = v;
+     }
+}
+
+static void evaluate_tree_batch_cached ( lnode **, batchspace *, int, int,
+                                        batchinfo *, DATATYPE *, DATATYPE *,
+                                        int );
+
+/* prepare_batch_hashes()
+ *
+ * hashes every subtree of the tree for the subtree memo and spines.  the
+ * batch evaluator is called once per block of cases, so this is only
+ * redone when a different tree comes along or a new sweep over the cases
+ * starts at case 0.  returns 1 if it was redone.
+ */
+
+static int prepare_batch_hashes ( batchspace *ws, lnode *tree, batchinfo *b )
+{
+     int lnodes;
+
+     if ( ws->tree == tree && b->first > 0 )
+          return 0;
+
+     /* ERCs take two lnodes, and batch capable trees have no others. */
+     lnodes = tree_nodes ( tree ) * 2;
+     if ( lnodes > ws->lnodes )
+     {
+          if ( ws->hash )
+          {
+               FREE ( ws->hash );
+               FREE ( ws->span );
+               FREE ( ws->worth );
+          }
+          ws->hash = (unsigned long long *)MALLOC ( lnodes *
+                                                   sizeof ( unsigned long long ) );
+          ws->span = (int *)MALLOC ( lnodes * sizeof ( int ) );
+          ws->worth = (char *)MALLOC ( lnodes * sizeof ( char ) );
+          ws->lnodes = lnodes;
+     }
+
+     memo_hash_tree ( tree, ws->hash, ws->span, ws->worth );
+     ws->tree = tree;
+     return 1;
+}
+
+/* prepare_batch_spines()
+ *
+ * at the start of a sweep over an individual that is being evaluated,
+ * picks up the spine it inherited and gives it a new one of its own to
+ * fill in, unless it already has one.
+ */
+
+static void prepare_batch_spines ( batchspace *ws, individual *ind,
+                                   int whichtree, batchinfo *b )
+{
+     ws->from = ind->ln.from;
+     ws->edit = ind->ln.edit;
+     ws->shift = ind->ln.shift;
+     ws->rec = NULL;
+     if ( ind->ln.own == NULL )
+          ws->rec = ind->ln.own = new_spine ( ws->tree, whichtree, b->cases,
+                                              ws->hash, ws->span );
+}
+
+/* evaluate_batch_capable()
+ *
+ * returns 1 if every member of function set fs can be evaluated by
+ * evaluate_tree_batch():  functions and normal terminals must supply a
+ * vcode, and only FUNC_DATA, TERM_NORM and TERM_ERC types may appear.
+ */
+
+int evaluate_batch_capable ( int fs )
+{
+     int i;
+     function *f;
+
+     for ( i = 0; i < fset[fs].size; ++i )
+     {
+          f = fset[fs].cset + i;
+          switch ( f->type )
+          {
+             case FUNC_DATA:
+             case TERM_NORM:
+               if ( f->vcode == NULL )
+                    return 0;
+               break;
+             case TERM_ERC:
+               break;
+             default:
+               return 0;
+          }
+     }
+     return 1;
+}
+
+/* evaluate_tree_batch()
+ *
+ * evaluates a tree over a whole block of fitness cases at once.  each node
+ * is visited once per block instead of once per case, and its vcode is
+ * handed whole columns of argument values.  the results are left in
+ * out[0..b->count-1].  the tree must come from a function set for which
+ * evaluate_batch_capable() is true.
+ */
+
+void evaluate_tree_batch ( lnode *tree, int whichtree, batchinfo *b,
+                          DATATYPE *out )
+{
+     lnode *l = tree;
+     batchspace *ws = get_batchspace();
+     individual *ind;
+     int depth;
+
+     /* a FUNC_DATA node holds arity-1 columns while its children are
+	evaluated, so the tree depth bounds how many are live at once.  the
+	depth is kept on an individual's trees; only a tree that belongs to
+	no individual has to be walked for it, block after block. */
+     ind = CURRENT_INDIVIDUAL;
+     if ( ind && ind->tr[whichtree].data == tree && ind->tr[whichtree].depth >= 0 )
+          depth = ind->tr[whichtree].depth;
+     else
+          depth = tree_depth ( tree );
+     reserve_batchspace ( ws, ( depth + 1 ) * ( MAXARGS - 1 ), b->count );
+
+     ws->memo = subtree_memo_enabled();
+     ws->depth = spine_depth();
+     if ( ws->depth && !( ind && ind->evald != EVAL_CACHE_VALID &&
+                          ind->tr[whichtree].data == tree ) )
+	  /* spines only follow individuals as they are evaluated. */
+          ws->depth = 0;
+
+     if ( !ws->memo && !ws->depth )
+     {
+          evaluate_tree_batch_recurse ( &l, whichtree, b, out, ws->column,
+                                       ws->stride );
+          return;
+     }
+
+     if ( prepare_batch_hashes ( ws, tree, b ) && ws->depth )
+          prepare_batch_spines ( ws, ind, whichtree, b );
+     evaluate_tree_batch_cached ( &l, ws, 0, whichtree, b, out, ws->column,
+                                 ws->stride );
+}
+
+/* evaluate_tree_batch_cached()
+ *
+ * the batch evaluator with the subtree memo or spines turned on.  before a
+ * function node below the root is evaluated its column is looked for in
+ * the parent's spine and then in the memo, and if it is found the whole
+ * subtree is skipped.  columns of nodes the spine covers are saved in the
+ * individual's own spine.  terminals are handed to
+ * evaluate_tree_batch_recurse().
+ */
+
+static void evaluate_tree_batch_cached ( lnode **l, batchspace *ws,
+                                        int depth, int whichtree,
+                                        batchinfo *b, DATATYPE *out,
+                                        DATATYPE *scratch, int stride )
+{
+     DATATYPE *arg[MAXARGS];
+     DATATYPE *c;
+     function *f = (**l).f;
+     int p = *l - ws->tree;
+     int spined = depth > 0 && depth <= ws->depth;
+     int memo = MEMO_MISS;
+     int q, i;
+
+     if ( f->type != FUNC_DATA )
+     {
+          evaluate_tree_batch_recurse ( l, whichtree, b, out, scratch, stride );
+          return;
+     }
+
+     if ( spined && ws->from )
+     {
+	  /* past the splice, the parent's lnodes sit shift further on. */
+          q = ( ws->edit < 0 || p < ws->edit ) ? p : p + ws->shift;
+          c = spine_column ( ws->from, whichtree, q, ws->hash[p],
+                             ws->span[p], b );
+          if ( c )
+          {
+               memcpy ( out, c, b->count * sizeof ( DATATYPE ) );
+               if ( ws->rec )
+               {
+                    spine_save ( ws->rec, p, b, out );
+                    spine_inherit ( ws->rec, ws->from, whichtree, p, q,
+                                    ws->span[p], b );
+               }
+               *l += ws->span[p];
+               return;
+          }
+     }
+
+     if ( ws->memo && p > 0 && ws->worth[p] )
+     {
+          memo = memo_lookup ( ws->hash[p], ws->span[p], whichtree, b, out );
+          if ( memo == MEMO_HIT )
+          {
+               if ( spined && ws->rec )
+                    spine_save ( ws->rec, p, b, out );
+               *l += ws->span[p];
+               return;
+          }
+     }
+
+     ++*l;
+     arg[0] = out;
+     for ( i = 1; i < f->arity; ++i )
+     {
+          arg[i] = scratch;
+          scratch += stride;
+     }
+     for ( i = 0; i < f->arity; ++i )
+          evaluate_tree_batch_cached ( l, ws, depth+1, whichtree, b, arg[i],
+                                      scratch, stride );
+     (f->vcode)(whichtree, b, out, arg);
+
+     if ( memo == MEMO_ADMIT )
+          memo_store ( ws->hash[p], ws->span[p], whichtree, b, out );
+     if ( spined && ws->rec )
+          spine_save ( ws->rec, p, b, out );
+}
+
+/* evaluate_tree_batch_recurse()
+ *
+ * the recursive part of the batch evaluator.  the first argument of a
+ * function is evaluated directly into out; the others go into scratch
+ * columns, and the rest of the scratch space is passed down.
+ */
+
+void evaluate_tree_batch_recurse ( lnode **l, int whichtree, batchinfo *b,
+                                  DATATYPE *out, DATATYPE *scratch,
+                                  int stride )
+{
+     DATATYPE *arg[MAXARGS];
+     DATATYPE d;
+     function *f = (**l).f;
+     int i;
+
+     ++*l;
+
+     switch ( f->type )
+     {
+        case FUNC_DATA:
+          arg[0] = out;
+          for ( i = 1; i < f->arity; ++i )
+          {
+               arg[i] = scratch;
+               scratch += stride;
+          }
+          for ( i = 0; i < f->arity; ++i )
+               evaluate_tree_batch_recurse ( l, whichtree, b, arg[i],
+                                            scratch, stride );
+          (f->vcode)(whichtree, b, out, arg);
+          break;
+        case TERM_ERC:
+          d = (*((*l)++)).d;
+          for ( i = 0; i < b->count; ++i )
+               out[i] = d;
+          break;
+        case TERM_NORM:
+          (f->vcode)(whichtree, b, out, NULL);
+          break;
+        default:
+          error ( E_FATAL_ERROR, "batch evaluation of unsupported node type %d.",
+                 f->type );
+     }
+}
@@ -25,7 +25,7 @@
  *  
  */
 
-#include <sys/types.h>
+#include <stdio.h>
 #include <time.h>
 
 #include "event.h"
@@ -38,15 +38,23 @@ void event_init ( void )
      
 void event_mark ( event *e )
 {
-     e->wall = time(NULL);
+     struct timespec ts;
+
+     clock_gettime ( CLOCK_MONOTONIC, &ts );
+     e->wall = ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
 char *event_string ( event *z )
 {
-     sprintf ( string, "%ds wall", z->wall );
+     sprintf ( string, "%.3lfs wall", z->wall / 1e9 );
      return string;
 }
 
+long long event_nsec ( event *z )
+{
+     return z->wall;
+}
+
 void event_zero ( event *z )
 {
      z->wall = 0;
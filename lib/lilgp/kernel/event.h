@@ -28,17 +28,19 @@
 #ifndef _EVENT_H
 #define _EVENT_H
 
-#include <sys/types.h>
 #include <time.h>
 
+/* wall clock time from the monotonic clock, in nanoseconds. */
+
 typedef struct 
 {
-     clock_t wall;
+     long long wall;
 } event;
 
 void event_init ( void );
 void event_mark ( event *e );
 char *event_string ( event *z );
+long long event_nsec ( event *z );
 void event_zero ( event *z );
 void event_diff ( event *z, event *one, event *two );
 void event_accum ( event *z, event *one );
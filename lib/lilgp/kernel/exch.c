@@ -471,21 +471,13 @@ void exchange_subpopulations ( multipop *mpop )
                     
                     /** remove the old iondividual from the population. **/
                     for ( j = 0; j < tree_count; ++j )
-                    {
-			 /* always dereference ERCs when removing trees
-			    from the population. */
-                         reference_ephem_constants ( mpop->pop[tp]->ind[ti].tr[j].data, -1 );
                          free_tree ( mpop->pop[tp]->ind[ti].tr+j );
-                    }
 
 		    /* copy the individual. */
+                    release_lineage ( mpop->pop[tp]->ind+ti );
                     duplicate_individual ( mpop->pop[tp]->ind+ti,
                                            mpop->pop[fp[0]]->ind+fi[0] );
 
-		    /* reference the ERCs in the new individual. */
-                    for ( j = 0; j < tree_count; ++j )
-                         reference_ephem_constants ( mpop->pop[tp]->ind[ti].tr[j].data, 1 );
-
 		    /* mark the individual as just coming from an exchange. */
                     mpop->pop[tp]->ind[ti].flags = FLAG_NEWEXCH;
                }
@@ -584,19 +576,16 @@ void exchange_subpopulations ( multipop *mpop )
                          if ( fp[j] == -1 )
                               continue;
 
-			 /* dereference ERCs in old tree. */
-                         reference_ephem_constants ( mpop->pop[tp]->ind[ti].tr[j].data, -1 );
 			 /* delete old tree. */
                          free_tree ( mpop->pop[tp]->ind[ti].tr+j );
 			 /* copy new tree. */
                          copy_tree ( mpop->pop[tp]->ind[ti].tr+j, mpop->pop[fp[j]]->ind[fi[j]].tr+j );
-			 /* reference ERCs in new tree. */
-                         reference_ephem_constants ( mpop->pop[tp]->ind[ti].tr[j].data, 1 );
                     }
 #ifdef COEVOLUTION
     error ( E_FATAL_ERROR, "Can't do COEVOLUTION and multi-pop experiments\n       together at this time, sorry.\n");
 #else
 		    /* evaluate the fitness of the new composite individual. */
+                    release_lineage ( mpop->pop[tp]->ind+ti );
                     app_eval_fitness ( mpop->pop[tp]->ind+ti );
 #endif
                     mpop->pop[tp]->ind[ti].flags = FLAG_NEWEXCH;
@@ -0,0 +1,233 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+
+#ifdef POSIX_MT
+#include <pthread.h>
+#endif
+
+/* the fitness cache.  breeding produces many offspring that are the same
+ * program as an individual evaluated before, but only a straight copy of
+ * an evaluated individual keeps EVAL_CACHE_VALID.  this remembers the
+ * fitness of recently evaluated programs by the hash of their trees (see
+ * individual_hash()), so evaluate_individual() can skip running them over
+ * the fitness cases again.
+ *
+ * the table is a fixed number of buckets of FCACHE_WAYS entries each.  a
+ * new entry goes in at the front of its bucket and pushes the oldest out.
+ * buckets are guarded by a set of striped locks, so the evaluation threads
+ * rarely wait on each other.  each stripe keeps its own lookup counts.
+ *
+ * with COEVOLUTION fitness depends on the opponent as well, so there is
+ * nothing to cache and evaluate_individual() is not available.
+ */
+
+#define FCACHE_WAYS    4
+#define FCACHE_LOCKS   64
+
+typedef struct
+{
+     unsigned long long key;   /* 0 marks an empty entry */
+     int size;                 /* total lnodes, as a guard against collisions */
+     int hits;
+     double r_fitness, s_fitness, a_fitness;
+} fcache_entry;
+
+static fcache_entry *table = NULL;
+static unsigned long bucket_mask = 0;
+static long lookups[FCACHE_LOCKS];
+static long found[FCACHE_LOCKS];
+
+#ifdef POSIX_MT
+static pthread_mutex_t locks[FCACHE_LOCKS];
+#define LOCK(b)   pthread_mutex_lock ( locks+((b)%FCACHE_LOCKS) )
+#define UNLOCK(b) pthread_mutex_unlock ( locks+((b)%FCACHE_LOCKS) )
+#else
+#define LOCK(b)
+#define UNLOCK(b)
+#endif
+
+/* initialize_fitness_cache()
+ *
+ * sizes the cache from the "eval.cache_size" parameter (a number of
+ * entries, rounded up to a power of two).  zero turns it off.
+ */
+
+void initialize_fitness_cache ( void )
+{
+     long size;
+     unsigned long buckets;
+#ifdef POSIX_MT
+     int i;
+#endif
+
+     size = atol ( get_parameter ( "eval.cache_size" ) );
+     if ( size < 0 )
+          error ( E_FATAL_ERROR, "eval.cache_size must be >= 0" );
+     if ( size == 0 )
+          return;
+
+     for ( buckets = 1; buckets * FCACHE_WAYS < (unsigned long)size; buckets *= 2 );
+     bucket_mask = buckets-1;
+
+     table = (fcache_entry *)MALLOC ( buckets * FCACHE_WAYS *
+                                      sizeof ( fcache_entry ) );
+     memset ( table, 0, buckets * FCACHE_WAYS * sizeof ( fcache_entry ) );
+     memset ( lookups, 0, sizeof ( lookups ) );
+     memset ( found, 0, sizeof ( found ) );
+
+#ifdef POSIX_MT
+     for ( i = 0; i < FCACHE_LOCKS; ++i )
+          pthread_mutex_init ( locks+i, NULL );
+#endif
+
+     oprintf ( OUT_SYS, 30, "    fitness cache of %lu entries.\n",
+               buckets * FCACHE_WAYS );
+}
+
+/* free_fitness_cache()
+ *
+ * frees the cache.
+ */
+
+void free_fitness_cache ( void )
+{
+#ifdef POSIX_MT
+     int i;
+#endif
+
+     if ( table == NULL )
+          return;
+
+#ifdef POSIX_MT
+     for ( i = 0; i < FCACHE_LOCKS; ++i )
+          pthread_mutex_destroy ( locks+i );
+#endif
+     FREE ( table );
+     table = NULL;
+}
+
+/* get_fitness_cache_stats()
+ *
+ * returns the number of lookups and how many of them were hits.
+ */
+
+void get_fitness_cache_stats ( long *l, long *f )
+{
+     int i;
+
+     *l = *f = 0;
+     for ( i = 0; i < FCACHE_LOCKS; ++i )
+     {
+          *l += lookups[i];
+          *f += found[i];
+     }
+}
+
+#ifndef COEVOLUTION
+
+/* individual_lnodes()
+ *
+ * the total lnode count of an individual's trees.
+ */
+
+static int individual_lnodes ( individual *ind )
+{
+     int j, n = 0;
+     for ( j = 0; j < tree_count; ++j )
+          n += ind->tr[j].size;
+     return n;
+}
+
+/* evaluate_individual()
+ *
+ * evaluates one individual, taking its fitness from the cache if the same
+ * program has been evaluated recently and adding it to the cache if not.
+ * either way the spine inherited from its parent is no longer needed.
+ */
+
+void evaluate_individual ( individual *ind )
+{
+     unsigned long long key;
+     unsigned long b;
+     fcache_entry *e;
+     int size, i;
+
+     if ( table == NULL )
+     {
+          app_eval_fitness ( ind );
+          release_spine ( ind->ln.from );
+          ind->ln.from = NULL;
+          return;
+     }
+
+     key = individual_hash ( ind );
+     if ( key == 0 )
+          key = 1;
+     size = individual_lnodes ( ind );
+     b = (unsigned long)(key ^ (key >> 32)) & bucket_mask;
+     e = table + b*FCACHE_WAYS;
+
+     LOCK(b);
+     ++lookups[b%FCACHE_LOCKS];
+     for ( i = 0; i < FCACHE_WAYS; ++i )
+          if ( e[i].key == key && e[i].size == size )
+          {
+               ind->r_fitness = e[i].r_fitness;
+               ind->s_fitness = e[i].s_fitness;
+               ind->a_fitness = e[i].a_fitness;
+               ind->hits = e[i].hits;
+               ind->evald = EVAL_CACHE_VALID;
+               ++found[b%FCACHE_LOCKS];
+               UNLOCK(b);
+               release_spine ( ind->ln.from );
+               ind->ln.from = NULL;
+               return;
+          }
+     UNLOCK(b);
+
+     app_eval_fitness ( ind );
+     release_spine ( ind->ln.from );
+     ind->ln.from = NULL;
+
+     /* a bound depends on the generation it was set in. */
+     if ( ind->flags & FLAG_BOUNDED )
+          return;
+
+     LOCK(b);
+     memmove ( e+1, e, (FCACHE_WAYS-1) * sizeof ( fcache_entry ) );
+     e[0].key = key;
+     e[0].size = size;
+     e[0].hits = ind->hits;
+     e[0].r_fitness = ind->r_fitness;
+     e[0].s_fitness = ind->s_fitness;
+     e[0].a_fitness = ind->a_fitness;
+     UNLOCK(b);
+}
+
+#endif
@@ -27,70 +27,156 @@
 
 #include <lilgp.h>
 
-/* initialize_genspace()
+/* every thread that builds trees has its own set of GENSPACE_COUNT
+ * generation spaces, and "gensp" points at the calling thread's set.  the
+ * main thread uses main_gensp; each pool worker is bound to one of the
+ * thread_gensp sets when it starts.
+ */
+
+static genspace main_gensp[GENSPACE_COUNT];
+_Thread_local genspace *gensp = main_gensp;
+
+static genspace *thread_gensp = NULL;
+static int thread_gensp_count = 0;
+
+/* alloc_genspace_set()
  *
- * allocates each genspace with GENSPACE_START lnodes.
+ * allocates each genspace in a set with GENSPACE_START lnodes.
  */
 
-void initialize_genspace ( void )
+static void alloc_genspace_set ( genspace *set )
 {
      int i;
 
-     oputs ( OUT_SYS, 30, "    generation spaces.\n" );
-     
      for ( i = 0; i < GENSPACE_COUNT; ++i )
      {
-          gensp[i].size = GENSPACE_START;
-          gensp[i].data = (lnode *)MALLOC ( gensp[i].size * sizeof ( lnode ) );
-          memset ( gensp[i].data, 0, gensp[i].size * sizeof ( lnode ) );
-          gensp[i].used = 0;
+          set[i].size = GENSPACE_START;
+          set[i].data = (lnode *)MALLOC ( set[i].size * sizeof ( lnode ) );
+          set[i].used = 0;
 #ifdef DEBUG
           printf ( "genspace %d initialized with %d nodes.\n",
-                  i, gensp[i].size );
+                  i, set[i].size );
 #endif
      }
 }
 
-/* free_genspace()
+/* free_genspace_set()
  *
- * frees all the genspaces.
+ * frees each genspace in a set.
  */
 
-void free_genspace ( void )
+static void free_genspace_set ( genspace *set )
 {
      int i;
      for ( i = 0; i < GENSPACE_COUNT; ++i )
      {
-          FREE ( gensp[i].data );
-          gensp[i].data = NULL;
+          FREE ( set[i].data );
+          set[i].data = NULL;
      }
 }
 
+/* initialize_genspace()
+ *
+ * allocates the main thread's genspaces.
+ */
+
+void initialize_genspace ( void )
+{
+     oputs ( OUT_SYS, 30, "    generation spaces.\n" );
+
+     alloc_genspace_set ( main_gensp );
+}
+
+/* free_genspace()
+ *
+ * frees all the genspaces.
+ */
+
+void free_genspace ( void )
+{
+     free_thread_genspace();
+     free_genspace_set ( main_gensp );
+}
+
+/* initialize_thread_genspace()
+ *
+ * allocates a set of genspaces for each of count worker threads.
+ */
+
+void initialize_thread_genspace ( int count )
+{
+     int i;
+
+     thread_gensp = (genspace *)MALLOC ( count * GENSPACE_COUNT *
+                                         sizeof ( genspace ) );
+     thread_gensp_count = count;
+     for ( i = 0; i < count; ++i )
+          alloc_genspace_set ( thread_gensp + i*GENSPACE_COUNT );
+}
+
+/* free_thread_genspace()
+ *
+ * frees the worker threads' genspaces.
+ */
+
+void free_thread_genspace ( void )
+{
+     int i;
+
+     if ( thread_gensp == NULL )
+          return;
+     for ( i = 0; i < thread_gensp_count; ++i )
+          free_genspace_set ( thread_gensp + i*GENSPACE_COUNT );
+     FREE ( thread_gensp );
+     thread_gensp = NULL;
+     thread_gensp_count = 0;
+}
+
+/* bind_thread_genspace()
+ *
+ * makes set index the calling thread's genspaces.
+ */
+
+void bind_thread_genspace ( int index )
+{
+     if ( index < 0 || index >= thread_gensp_count )
+          error ( E_FATAL_ERROR, "no genspace set %d.", index );
+     gensp = thread_gensp + index*GENSPACE_COUNT;
+}
+
+/* gensp_grow()
+ *
+ * enlarges a full generation space.  the size is doubled (but grows by
+ * at least GENSPACE_GROW lnodes), so building a deep tree costs only a
+ * handful of reallocations.  the new lnodes are not cleared:  every lnode
+ * is written before it is read.
+ */
+
+static void gensp_grow ( genspace *g )
+{
+     int oldsize = g->size;
+
+     g->size += ( oldsize > GENSPACE_GROW ) ? oldsize : GENSPACE_GROW;
+     g->data = (lnode *)REALLOC ( g->data, g->size * sizeof ( lnode ) );
+#ifdef DEBUG
+     printf ( "genspace grown to %d nodes from %d.\n", g->size, oldsize );
+#endif
+}
+
 /* gensp_next()
  *
  * returns the address of the next free lnode in the given generation
- * space.  enlarges the generation space by GENSPACE_GROW lnodes if
- * there is no free space.
+ * space.  enlarges the generation space if there is no free space.
  */
 
 lnode * gensp_next ( int space )
 {
-     while ( gensp[space].used >= gensp[space].size )
-     {
-          int oldsize = gensp[space].size;
-          gensp[space].size += GENSPACE_GROW;
-          gensp[space].data = (lnode *)REALLOC ( gensp[space].data,
-                                                gensp[space].size *
-                                                sizeof ( lnode ) );
-          memset ( gensp[space].data+oldsize, 0,
-                   (gensp[space].size-oldsize) * sizeof ( lnode ) );
-#ifdef DEBUG
-          printf ( "next: genspace %d grown to %d nodes.\n",
-                  space, gensp[space].size );
-#endif
-     }
+     genspace *g = gensp+space;
 
-     return gensp[space].data+(gensp[space].used++);
+     if ( g->used >= g->size )
+          gensp_grow ( g );
+
+     return g->data+(g->used++);
 }
 
 /* gensp_next_int()
@@ -101,22 +187,29 @@ lnode * gensp_next ( int space )
 
 int gensp_next_int ( int space )
 {
-     while ( gensp[space].used >= gensp[space].size )
-     {
-          int oldsize = gensp[space].size;
-          gensp[space].size += GENSPACE_GROW;
-          gensp[space].data = (lnode *)REALLOC ( gensp[space].data,
-                                                gensp[space].size *
-                                                sizeof ( lnode ) );
-          memset ( gensp[space].data+oldsize, 0,
-                   (gensp[space].size-oldsize) * sizeof ( lnode ) );
-#ifdef DEBUG
-          printf ( "next_int: genspace %d grown to %d nodes from %d.\n",
-                  space, gensp[space].size, oldsize );
-#endif
-     }
+     genspace *g = gensp+space;
+
+     if ( g->used >= g->size )
+          gensp_grow ( g );
+
+     return g->used++;
+}
+
+/* gensp_next_block()
+ *
+ * like gensp_next(), but returns the address of n consecutive free
+ * lnodes.
+ */
+
+lnode * gensp_next_block ( int space, int n )
+{
+     genspace *g = gensp+space;
+
+     while ( g->used + n > g->size )
+          gensp_grow ( g );
 
-     return gensp[space].used++;
+     g->used += n;
+     return g->data+(g->used-n);
 }
 
 /* gensp_dup_tree()
@@ -128,20 +221,20 @@ int gensp_next_int ( int space )
 void gensp_dup_tree ( int space, tree *t )
 {
      t->size = gensp[space].used;
-     t->nodes = tree_nodes ( gensp[space].data );
-     t->data = (lnode *)MALLOC ( t->size * sizeof ( lnode ) );
+     allocate_tree ( t, t->size );
      memcpy ( t->data, gensp[space].data, t->size * sizeof ( lnode ) );
+     measure_tree ( t );
 }
 
 /* gensp_reset()
  *
- * marks a genspace as being empty.
+ * marks a genspace as being empty.  the old contents are left in place
+ * since they will be overwritten before they are read.
  */
 
 void gensp_reset ( int space )
 {
      gensp[space].used = 0;
-     memset ( gensp[space].data, 0, gensp[space].size * sizeof ( lnode ) );
 }
 
 /* gensp_print()
@@ -169,7 +262,7 @@ void gensp_print ( int space, int i, int j, FILE *out )
                f = gensp[space].data[u].f;
                if ( f->ephem_gen )
                {
-                    fprintf(out, "[%d: %s] [%d: ERC] ", u, (f->ephem_str)(gensp[space].data[u+1].d->d), u+1);
+                    fprintf(out, "[%d: %s] [%d: ERC] ", u, (f->ephem_str)(gensp[space].data[u+1].d), u+1);
                     ++u;
                }     
                else
@@ -30,20 +30,46 @@
 popstats* run_stats;
 saved_ind* saved_head, * saved_tail;
 
+/* time spent in application callbacks during the current generation. */
+static event app_time;
+
+/* whether each line of the .stt file is also written to the .stb file. */
+static int stt_binary = 0;
+
 #if !defined(POSIX_MT) && !defined(SOLARIS_MT)
 
 globaldata global_g;
 
 #else
 
+#include <stdatomic.h>
+
 int numthreads = 0;
 
+/* individuals claimed by a worker at a time, and whether to hand out the
+   biggest trees first. */
+static int eval_grain = 1;
+static int eval_largest_first = 0;
+
+/* the adjusted fitness an individual must be able to beat to be worth
+   evaluating in full (see get_evaluation_bound()), and the quantile of the
+   previous generation's fitness it is taken from. */
+static double evaluation_bound = -HUGE_VAL;
+static double eval_bound_quantile = 0.0;
+
+/* the evaluation work list shared by the pool workers.  workers claim
+   eval_grain entries of "order" at a time by bumping "next", so a thread
+   that drew cheap individuals simply comes back for more. */
 struct thread_param_t
 {
     population* pop;
-    int startidx;
-    int endidx;
+    int* order;
+    int count;
+    int evals;             /* the first evals entries need evaluating */
+    int grain;
+    atomic_int next;
     globaldata g;
+    pop_summary** part;    /* each worker's statistics, or NULL */
 };
 
 #ifdef POSIX_MT
@@ -61,6 +87,67 @@ static thread_key_t         g_key;
 
 #endif /* !defined(POSIX_MT) && !defined(SOLARIS_MT) */
 
+/* write_phase_time()
+ *
+ * writes how long a phase of generation gen took to the .tim stream, as a
+ * "GEN# PHASE THREAD NS" line.  with workers set, a line follows for each
+ * pool worker with the time it spent busy during the phase.
+ */
+
+static void write_phase_time(int gen, char* phase, long long ns, int workers)
+{
+#ifdef POSIX_MT
+    event* busy;
+    int i, n;
+#endif
+    
+    oprintf(OUT_TIM, 50, "%d\t%s\tall\t%lld\n", gen, phase, ns);
+    
+#ifdef POSIX_MT
+    if (!workers)
+        return;
+    n = worker_pool_size();
+    busy = (event*) MALLOC(n * sizeof(event));
+    take_worker_busy(busy);
+    for (i = 0; i < n; ++i)
+        oprintf(OUT_TIM, 50, "%d\t%s\t%d\t%lld\n", gen, phase, i,
+                event_nsec(busy + i));
+    FREE(busy);
+#endif
+}
+
+/* fill_stb_stats(), write_stb_record()
+ *
+ * append the statistics printed on one line of the .stt file to the .stb
+ * file:  those of generation gen for subpopulation sub (0 for the whole
+ * population), and of the run so far.
+ */
+
+static void fill_stb_stats(stb_stats* s, popstats* p)
+{
+    s->meanfit = p->totalfit / p->size;
+    s->bestfit = p->bestfit;
+    s->worstfit = p->worstfit;
+    s->meannodes = (double) p->totalnodes / p->size;
+    s->meandepth = (double) p->totaldepth / p->size;
+    s->bestnodes = p->bestnodes;
+    s->bestdepth = p->bestdepth;
+    s->worstnodes = p->worstnodes;
+    s->worstdepth = p->worstdepth;
+}
+
+static void write_stb_record(int gen, int sub, popstats* g, popstats* r)
+{
+    stb_record rec;
+    
+    memset(&rec, 0, sizeof(stb_record));
+    rec.gen = gen;
+    rec.sub = sub;
+    fill_stb_stats(&rec.g, g);
+    fill_stb_stats(&rec.r, r);
+    fwrite(&rec, sizeof(stb_record), 1, output_filehandle(OUT_STB));
+}
+
 /* run_gp()
  *
  * the whole enchilada.  runs, from generation startgen, using population
@@ -80,9 +167,11 @@ void run_gp(multipop* mpop, int startgen,
     char* checkfileformat;
     char* checkfilename = NULL;
     event start, end, diff;
+    long long app_before;
     int term = 0;
     int stt_interval;
     int bestn;
+    double* bounds;
     
     if (!startfromcheckpoint)
     {
@@ -147,6 +236,16 @@ void run_gp(multipop* mpop, int startgen,
     checkfileformat = get_parameter("checkpoint.filename");
     checkfilename = (char*) MALLOC(strlen(checkfileformat) + 50);
     
+    /* get the quantile of each generation's fitness that the next must
+       be able to beat; zero turns bounded evaluation off. */
+    eval_bound_quantile = atof(get_parameter("eval.bound_quantile"));
+    if (eval_bound_quantile < 0.0 || eval_bound_quantile >= 1.0)
+        error(E_FATAL_ERROR,
+              "\"eval.bound_quantile\" must be at least 0 and below 1.");
+    bounds = (double*) MALLOC(mpop->size * sizeof(double));
+    for (i = 0; i < mpop->size; ++i)
+        bounds[i] = -HUGE_VAL;
+    
     /* get the interval for writing information to the .stt file. */
     stt_interval = atoi(get_parameter("output.stt_interval"));
     if (stt_interval < 1)
@@ -172,12 +271,36 @@ void run_gp(multipop* mpop, int startgen,
     oprintf(OUT_STT, 50, "GEN#\tSUB#\tμFGEN\tFsBestGEN\tFsWorstGEN\tμTreeSzGEN\tμTreeDpGEN\tbTreeSzGEN\tbTreeDpGEN\twTreeSzGEN\twTreeDpGEN\tμFRUN\t"
                          "FsBestRUN\tFsWorstRUN\tμTreeSzRUN\tμTreeDpRUN\tbTreeSzRUN\tbTreeDpRUN\twTreeSzRUN\twTreeDpRUN\n");
     
+    /* the binary copy of the .stt file starts with a header saying how
+       its records are laid out. */
+    stt_binary = translate_binary(get_parameter("output.stt_binary"));
+    if (stt_binary == -1)
+        error(E_FATAL_ERROR,
+              "\"output.stt_binary\" must be \"on\" or \"off\".");
+    if (stt_binary)
+    {
+        stb_header h;
+        
+        memset(&h, 0, sizeof(stb_header));
+        memcpy(h.magic, STB_MAGIC, sizeof(h.magic));
+        h.version = STB_VERSION;
+        h.recsize = sizeof(stb_record);
+        fwrite(&h, sizeof(stb_header), 1, output_filehandle(OUT_STB));
+    }
+    
+    output_stream_open(OUT_TIM);
+    oprintf(OUT_TIM, 50, "GEN#\tPHASE\tTHREAD\tNS\n");
+    
     /* the big loop. */
     for (gen = startgen; gen <= maxgen && !term; ++gen)
     {
         oprintf(OUT_SYS, 20,
                 "=== generation %d.\n", gen);
+        event_zero(&app_time);
+        event_mark(&start);
         app_begin_of_evaluation(gen, mpop);
+        event_mark(&end);
+        event_accumdiff(&app_time, &start, &end);
         
         /* unless this is the first generation after loading a checkpoint
        file... */
@@ -186,8 +309,14 @@ void run_gp(multipop* mpop, int startgen,
             
             /* evaluate the population. */
             event_mark(&start);
+            clear_subtree_memo();
             for (i = 0; i < mpop->size; ++i)
+            {
+                evaluation_bound = bounds[i];
                 evaluate_pop(mpop->pop[i]);
+                bounds[i] = fitness_quantile(mpop->pop[i], eval_bound_quantile);
+            }
+            evaluation_bound = -HUGE_VAL;
             event_mark(&end);
             event_diff(&diff, &start, &end);
 
@@ -199,11 +328,19 @@ void run_gp(multipop* mpop, int startgen,
 #endif
             
             event_accum(t_eval, &diff);
+            write_phase_time(gen, "eval", event_nsec(&diff), 1);
             
             /* calculate and print statistics.  returns 1 if user termination
-               criterion was met, 0 otherwise. */
+               criterion was met, 0 otherwise.  the time it spends in the
+               application callback is counted as such. */
+            app_before = event_nsec(&app_time);
+            event_mark(&start);
             term = generation_information(gen, mpop, stt_interval,
                                           run_stats[0].bestn);
+            event_mark(&end);
+            event_diff(&diff, &start, &end);
+            write_phase_time(gen, "stats", event_nsec(&diff) -
+                             (event_nsec(&app_time) - app_before), 0);
             if (term)
                 oprintf(OUT_SYS, 30, "user termination criterion met.\n");
             
@@ -220,7 +357,11 @@ void run_gp(multipop* mpop, int startgen,
              (checkinterval > 0 && gen > startgen && (gen % checkinterval) == 0)))
         {
             sprintf(checkfilename, checkfileformat, gen);
+            event_mark(&start);
             write_checkpoint(gen, mpop, checkfilename);
+            event_mark(&end);
+            event_diff(&diff, &start, &end);
+            write_phase_time(gen, "checkpoint", event_nsec(&diff), 0);
         }
         
         /** if this is not the last generation and the user criterion hasn't
@@ -231,7 +372,11 @@ void run_gp(multipop* mpop, int startgen,
             /** exchange subpops if it's time. **/
             if (mpop->size > 1 && gen && (gen % exch_gen) == 0)
             {
+                event_mark(&start);
                 exchange_subpopulations(mpop);
+                event_mark(&end);
+                event_diff(&diff, &start, &end);
+                write_phase_time(gen, "exchange", event_nsec(&diff), 0);
                 oprintf(OUT_SYS, 10,
                         "    subpopulation exchange complete.\n");
             }
@@ -242,9 +387,13 @@ void run_gp(multipop* mpop, int startgen,
                 mpop->pop[i] = change_population(mpop->pop[i], mpop->bpt[i]);
             event_mark(&end);
             event_diff(&diff, &start, &end);
+            write_phase_time(gen, "breed", event_nsec(&diff), 1);
             
             /* call the application end-of-breeding callback. */
+            event_mark(&start);
             app_end_of_breeding(gen, mpop);
+            event_mark(&end);
+            event_accumdiff(&app_time, &start, &end);
 
 #ifdef TIMING_AVAILABLE
             oprintf(OUT_SYS, 30, "    breeding complete.    (%s)\n",
@@ -257,9 +406,7 @@ void run_gp(multipop* mpop, int startgen,
             
         }
         
-        /* free unused ERCs. */
-        ephem_const_gc();
-        
+        write_phase_time(gen, "app", event_nsec(&app_time), 0);
         flush_output_streams();
         
     }
@@ -268,8 +415,7 @@ void run_gp(multipop* mpop, int startgen,
     
     if (checkfilename)
         FREE(checkfilename);
-    
-    ephem_const_gc();
+    FREE(bounds);
     
     for (i = 0; i < mpop->size + 1; ++i)
     {
@@ -297,6 +443,7 @@ int generation_information(int gen, multipop* mpop, int stt_interval,
     popstats* gen_stats;
     int ret = 0;
     FILE* bout, * hout;
+    event start, end;
     
     /* number of decimal digits to use when printing fitness values. */
     if (fd == -1)
@@ -405,6 +552,9 @@ int generation_information(int gen, multipop* mpop, int stt_interval,
                     run_stats[i + 1].bestnodes, run_stats[i + 1].bestdepth,
                     run_stats[i + 1].worstnodes, run_stats[i + 1].worstdepth);
             oprintf(OUT_STT, 50, "\n");
+            if (stt_binary)
+                write_stb_record(gen, i + 1, gen_stats + i + 1,
+                                 run_stats + i + 1);
         }
         
     }
@@ -489,6 +639,8 @@ int generation_information(int gen, multipop* mpop, int stt_interval,
                     run_stats[0].worstnodes, run_stats[0].worstdepth);
             oprintf(OUT_STT, 50, "\n");
         }
+        if (stt_binary)
+            write_stb_record(gen, 0, gen_stats, run_stats);
     }
     
     /* rewrite the .bst file, and append to the .his file. */
@@ -575,7 +727,10 @@ int generation_information(int gen, multipop* mpop, int stt_interval,
     
     /* call the end-of-evaluation callback.  returns 1 if user termination
        criterion is met, 0 otherwise. */
+    event_mark(&start);
     ret = app_end_of_evaluation(gen, mpop, newbest, gen_stats, run_stats);
+    event_mark(&end);
+    event_accumdiff(&app_time, &start, &end);
     
     /* close the .bst file. */
     output_stream_close(OUT_BST);
@@ -597,21 +752,271 @@ int generation_information(int gen, multipop* mpop, int stt_interval,
     
 }
 
+/* the statistics calculate_pop_stats() needs, gathered in a single pass
+   over a population.  the evaluation workers each gather those of the
+   individuals they evaluate, and the parts are merged at the end.
+   individuals are kept by index, so that ties between them are broken the
+   same way however the population was split up:  the best and worst are
+   the first of equals, and the top list puts later individuals ahead of
+   earlier ones of equal fitness. */
+
+struct _pop_summary
+{
+    int size;
+    int maxnodes, minnodes, totalnodes;
+    int maxdepth, mindepth, totaldepth;
+    int maxhits, minhits, totalhits;
+    double totalfit;
+    int best, worst;
+    int bestn;
+    int tops;
+    int* top;              /* the best tops individuals, best first */
+};
+
+/* new_pop_summary(), free_pop_summary()
+ *
+ * make an empty summary that keeps the best bestn individuals, and free
+ * one.  free_pop_summary() accepts NULL.
+ */
+
+static pop_summary* new_pop_summary(int bestn)
+{
+    pop_summary* sum;
+    
+    sum = (pop_summary*) MALLOC(sizeof(pop_summary));
+    memset(sum, 0, sizeof(pop_summary));
+    sum->best = sum->worst = -1;
+    sum->bestn = bestn;
+    sum->top = (int*) MALLOC(bestn * sizeof(int));
+    return sum;
+}
+
+void free_pop_summary(pop_summary* sum)
+{
+    if (sum == NULL)
+        return;
+    FREE(sum->top);
+    FREE(sum);
+}
+
+/* ahead_of_best(), ahead_of_worst(), ahead_in_top()
+ *
+ * the orders in which individuals a and b are compared for the best, the
+ * worst, and the top list.  -1 stands for no individual.
+ */
+
+static int ahead_of_best(population* pop, int a, int b)
+{
+    double fa = pop->ind[a].a_fitness;
+    
+    return b == -1 || fa > pop->ind[b].a_fitness ||
+           (fa == pop->ind[b].a_fitness && a < b);
+}
+
+static int ahead_of_worst(population* pop, int a, int b)
+{
+    double fa = pop->ind[a].a_fitness;
+    
+    return b == -1 || fa < pop->ind[b].a_fitness ||
+           (fa == pop->ind[b].a_fitness && a < b);
+}
+
+static int ahead_in_top(population* pop, int a, int b)
+{
+    double fa = pop->ind[a].a_fitness;
+    
+    return fa > pop->ind[b].a_fitness ||
+           (fa == pop->ind[b].a_fitness && a > b);
+}
+
+/* add_to_pop_summary()
+ *
+ * counts individual k of the population into a summary.
+ */
+
+static void add_to_pop_summary(pop_summary* sum, population* pop, int k)
+{
+    individual* ind = pop->ind + k;
+    int n, d, h, j;
+    
+    n = individual_size(ind);
+    d = individual_depth(ind);
+    h = ind->hits;
+    
+    if (sum->size++ == 0)
+    {
+        sum->maxnodes = sum->minnodes = n;
+        sum->maxdepth = sum->mindepth = d;
+        sum->maxhits = sum->minhits = h;
+    }
+    sum->totalnodes += n;
+    if (n < sum->minnodes) sum->minnodes = n;
+    if (n > sum->maxnodes) sum->maxnodes = n;
+    sum->totaldepth += d;
+    if (d < sum->mindepth) sum->mindepth = d;
+    if (d > sum->maxdepth) sum->maxdepth = d;
+    sum->totalhits += h;
+    if (h < sum->minhits) sum->minhits = h;
+    if (h > sum->maxhits) sum->maxhits = h;
+    sum->totalfit += ind->a_fitness;
+    
+    if (ahead_of_best(pop, k, sum->best))
+        sum->best = k;
+    if (ahead_of_worst(pop, k, sum->worst))
+        sum->worst = k;
+    
+    /* insert it into the top list, if it belongs there. */
+    if (sum->tops == sum->bestn &&
+        !ahead_in_top(pop, k, sum->top[sum->tops - 1]))
+        return;
+    if (sum->tops < sum->bestn)
+        ++sum->tops;
+    for (j = sum->tops - 1; j > 0 && ahead_in_top(pop, k, sum->top[j - 1]); --j)
+        sum->top[j] = sum->top[j - 1];
+    sum->top[j] = k;
+}
+
+#if (defined(POSIX_MT) || defined(SOLARIS_MT)) && !defined(COEVOLUTION)
+
+/* merge_pop_summary()
+ *
+ * merges the second summary of parts of a population into the first.
+ */
+
+static void merge_pop_summary(pop_summary* sum, pop_summary* part,
+                              population* pop)
+{
+    int* top;
+    int i, j, k;
+    
+    if (part->size == 0)
+        return;
+    if (sum->size == 0)
+    {
+        sum->maxnodes = part->maxnodes;
+        sum->minnodes = part->minnodes;
+        sum->maxdepth = part->maxdepth;
+        sum->mindepth = part->mindepth;
+        sum->maxhits = part->maxhits;
+        sum->minhits = part->minhits;
+    }
+    
+    sum->size += part->size;
+    sum->totalnodes += part->totalnodes;
+    if (part->minnodes < sum->minnodes) sum->minnodes = part->minnodes;
+    if (part->maxnodes > sum->maxnodes) sum->maxnodes = part->maxnodes;
+    sum->totaldepth += part->totaldepth;
+    if (part->mindepth < sum->mindepth) sum->mindepth = part->mindepth;
+    if (part->maxdepth > sum->maxdepth) sum->maxdepth = part->maxdepth;
+    sum->totalhits += part->totalhits;
+    if (part->minhits < sum->minhits) sum->minhits = part->minhits;
+    if (part->maxhits > sum->maxhits) sum->maxhits = part->maxhits;
+    sum->totalfit += part->totalfit;
+    
+    if (ahead_of_best(pop, part->best, sum->best))
+        sum->best = part->best;
+    if (ahead_of_worst(pop, part->worst, sum->worst))
+        sum->worst = part->worst;
+    
+    /* merge the two top lists, keeping the best bestn. */
+    top = (int*) MALLOC(sum->bestn * sizeof(int));
+    for (i = j = k = 0; k < sum->bestn && (i < sum->tops || j < part->tops); ++k)
+        if (j == part->tops ||
+            (i < sum->tops && ahead_in_top(pop, sum->top[i], part->top[j])))
+            top[k] = sum->top[i++];
+        else
+            top[k] = part->top[j++];
+    FREE(sum->top);
+    sum->top = top;
+    sum->tops = k;
+}
+
+#endif
+
 /* evaluate_pop()
  *
  * evaluates all the individuals in a population whose cached
- * fitness values are invalid.
+ * fitness values are invalid.  with the worker pool, the workers also
+ * gather the population's statistics and leave them in pop->summary.
+ */
+
+#if defined(POSIX_MT) || defined(SOLARIS_MT)
+
+/* population being ordered by evaluate_size_compare(). */
+static population* evaluate_sort_pop;
+
+/* evaluate_size_compare()
+ *
+ * comparison function for qsort() that orders population indices by
+ * decreasing individual size.
  */
 
+static int evaluate_size_compare(const void* a, const void* b)
+{
+    int na = 0, nb = 0, j;
+    individual* ia = evaluate_sort_pop->ind + *(const int*) a;
+    individual* ib = evaluate_sort_pop->ind + *(const int*) b;
+    
+    for (j = 0; j < tree_count; ++j)
+    {
+        na += ia->tr[j].nodes;
+        nb += ib->tr[j].nodes;
+    }
+    return nb - na;
+}
+
+#endif
+
+/* get_evaluation_bound()
+ *
+ * returns the adjusted fitness an individual must be able to beat for its
+ * evaluation to be worth finishing, or -HUGE_VAL if every individual is
+ * to be evaluated in full.  the application may stop evaluating an
+ * individual once it can no longer reach this, leaving the fitness it has
+ * scored so far and setting FLAG_BOUNDED.
+ */
+
+double get_evaluation_bound(void)
+{
+    return evaluation_bound;
+}
+
+/* fitness_quantile()
+ *
+ * returns the adjusted fitness below which the given fraction of the
+ * population falls, or -HUGE_VAL for a fraction of zero.
+ */
+
+static int double_compare(const void* a, const void* b)
+{
+    double da = *(const double*) a, db = *(const double*) b;
+    return (da > db) - (da < db);
+}
+
+double fitness_quantile(population* pop, double q)
+{
+    double* a;
+    double r;
+    int i;
+    
+    if (q <= 0.0 || pop->size == 0)
+        return -HUGE_VAL;
+    
+    a = (double*) MALLOC(pop->size * sizeof(double));
+    for (i = 0; i < pop->size; ++i)
+        a[i] = pop->ind[i].a_fitness;
+    qsort(a, pop->size, sizeof(double), double_compare);
+    r = a[(int) (q * (pop->size - 1))];
+    FREE(a);
+    
+    return r;
+}
+
 void evaluate_pop(population* pop)
 {
     int i;
 #if defined(POSIX_MT) || defined(SOLARIS_MT)
-    int start, end, inc, err;
-    struct thread_param_t* t_param;
-#endif
-#if POSIX_MT
-    pthread_t* t_ids;
+    struct thread_param_t t_param;
 #endif
 
 #ifdef DEBUG
@@ -640,60 +1045,72 @@ void evaluate_pop(population* pop)
 #else
       for ( i = 0; i < pop->size; ++i )
         if ( pop->ind[i].evald != EVAL_CACHE_VALID )
-          app_eval_fitness ( (pop->ind)+i );
+          evaluate_individual ( (pop->ind)+i );
 #endif
 
 #else
+    
+    /* list the individuals whose fitness is out of date. */
+    t_param.pop = pop;
+    t_param.order = (int*) MALLOC(pop->size * sizeof(int));
+    t_param.count = 0;
+    t_param.part = NULL;
+    for (i = 0; i < pop->size; ++i)
+#ifdef COEVOLUTION
+        if (i % 2 == 0 && (pop->ind[i].evald != EVAL_CACHE_VALID ||
+                           pop->ind[i + 1].evald != EVAL_CACHE_VALID))
+#else
+        if (pop->ind[i].evald != EVAL_CACHE_VALID)
+#endif
+            t_param.order[t_param.count++] = i;
+    t_param.evals = t_param.count;
 
-#if POSIX_MT
-    t_ids = (pthread_t*) MALLOC(numthreads * sizeof(pthread_t));
+#ifndef COEVOLUTION
+    /* evaluation cost grows with tree size, so starting the biggest trees
+       first keeps one late giant from holding up the whole generation. */
+    if (eval_largest_first)
+    {
+        evaluate_sort_pop = pop;
+        qsort(t_param.order, t_param.count, sizeof(int), evaluate_size_compare);
+    }
+    
+    /* while they are at it, the workers gather the population's statistics
+       for calculate_pop_stats().  the individuals that are already
+       evaluated go on the end of the list, so they are counted too. */
+    if (run_stats)
+    {
+        for (i = 0; i < pop->size; ++i)
+            if (pop->ind[i].evald == EVAL_CACHE_VALID)
+                t_param.order[t_param.count++] = i;
+        t_param.part = (pop_summary**) MALLOC(worker_pool_size() *
+                                              sizeof(pop_summary*));
+        for (i = 0; i < worker_pool_size(); ++i)
+            t_param.part[i] = new_pop_summary(run_stats[0].bestn);
+    }
 #endif
-    t_param = (struct thread_param_t*) MALLOC(numthreads *
-                                              sizeof(struct thread_param_t));
     
-    /* figure out how many pop members per thread */
-    inc = pop->size / numthreads;
-    if (pop->size != inc * numthreads) inc++;
+    t_param.grain = eval_grain;
+    atomic_init(&t_param.next, 0);
+    
+    /* every worker starts from a copy of the main thread's 'g'. */
+    t_param.g = *(get_globaldata());
     
-    start = 0;
-    for (i = 0; i < numthreads; i++)
+    run_worker_pool(evaluate_pop_chunk, &t_param);
+    
+    if (t_param.part)
     {
-        end = start + inc;
-        if (end > pop->size) end = pop->size;
-        
-        /* setup the paramater to pass */
-        t_param[i].pop = pop;
-        t_param[i].startidx = start;
-        t_param[i].endidx = end;
-        t_param[i].g = *(get_globaldata());
-
-#ifdef POSIX_MT
-        err = pthread_create(&t_ids[i], &pthread_attr,
-                             evaluate_pop_chunk, &t_param[i]);
-#endif
-#ifdef SOLARIS_MT
-        err = thr_create(NULL, (int)NULL, evaluate_pop_chunk,
-                 &t_param[i], (int)NULL,NULL);
-#endif
-        if (err != 0)
+        /* merge the workers' statistics. */
+        free_pop_summary(pop->summary);
+        pop->summary = t_param.part[0];
+        for (i = 1; i < worker_pool_size(); ++i)
         {
-            error(E_FATAL_ERROR, "cannot create thread");
+            merge_pop_summary(pop->summary, t_param.part[i], pop);
+            free_pop_summary(t_param.part[i]);
         }
-        
-        start = end;
-    }
-
-#ifdef SOLARIS_MT
-    while (thr_join(NULL, NULL, NULL) == 0);
-#endif
-#ifdef POSIX_MT
-    for (i = 0; i < numthreads; i++)
-    {
-        pthread_join(t_ids[i], NULL);
+        FREE(t_param.part);
     }
-    FREE(t_ids);
-#endif
-    FREE(t_param);
+    
+    FREE(t_param.order);
 
 #endif
 
@@ -702,86 +1119,62 @@ void evaluate_pop(population* pop)
 /* calculate_pop_stats()
  *
  * tabulates stats for a population:  fitness and size of best, worst,
- * mean, etc.  also finds top N individuals and saves them.
+ * mean, etc.  also finds top N individuals and saves them.  the stats
+ * gathered by evaluate_pop() are used if they are there; otherwise the
+ * population is gone through here.
  */
 
 void calculate_pop_stats(popstats* s, population* pop, int gen,
                          int subpop)
 {
-    int i, j, k, l;
+    int i;
     int b;
     saved_ind* shp;
     individual** temp;
+    pop_summary* sum;
     
     /* allocate a list of the top N individuals. */
     s->best = (saved_ind**) MALLOC(s->bestn *
                                    sizeof(saved_ind*));
     temp = (individual**) MALLOC((s->bestn + 1) * sizeof(individual*));
     
-    s->size = pop->size;
+    /* take the summary left by the evaluation workers. */
+    sum = pop->summary;
+    pop->summary = NULL;
+    if (sum == NULL || sum->size != pop->size || sum->bestn != s->bestn)
+    {
+        free_pop_summary(sum);
+        sum = new_pop_summary(s->bestn);
+        for (i = 0; i < pop->size; ++i)
+            add_to_pop_summary(sum, pop, i);
+    }
     
-    /** this is all pretty obvious -- set all the max and min values to the
-      first individual's values, then go through the population looking for
-      things that are bigger/smaller/better/worse/etc. **/
-    
-    s->maxnodes = s->minnodes = s->totalnodes = s->bestnodes = s->worstnodes =
-            individual_size(pop->ind + 0);
-    s->maxdepth = s->mindepth = s->totaldepth = s->bestdepth = s->worstdepth =
-            individual_depth(pop->ind + 0);
-    s->maxhits = s->minhits = s->totalhits = s->besthits = s->worsthits =
-            pop->ind[0].hits;
-    s->bestfit = s->worstfit = s->totalfit = pop->ind[0].a_fitness;
-    temp[0] = pop->ind;
-    b = 1;
+    s->size = pop->size;
+    s->maxnodes = sum->maxnodes;
+    s->minnodes = sum->minnodes;
+    s->totalnodes = sum->totalnodes;
+    s->maxdepth = sum->maxdepth;
+    s->mindepth = sum->mindepth;
+    s->totaldepth = sum->totaldepth;
+    s->maxhits = sum->maxhits;
+    s->minhits = sum->minhits;
+    s->totalhits = sum->totalhits;
+    s->totalfit = sum->totalfit;
+    
+    s->bestfit = pop->ind[sum->best].a_fitness;
+    s->bestnodes = individual_size(pop->ind + sum->best);
+    s->bestdepth = individual_depth(pop->ind + sum->best);
+    s->besthits = pop->ind[sum->best].hits;
+    s->worstfit = pop->ind[sum->worst].a_fitness;
+    s->worstnodes = individual_size(pop->ind + sum->worst);
+    s->worstdepth = individual_depth(pop->ind + sum->worst);
+    s->worsthits = pop->ind[sum->worst].hits;
     s->bestgen = s->worstgen = gen;
     s->bestpop = s->worstpop = subpop;
     
-    for (i = 1; i < s->size; ++i)
-    {
-        j = individual_size(pop->ind + i);
-        s->totalnodes += j;
-        if (j < s->minnodes) s->minnodes = j;
-        if (j > s->maxnodes) s->maxnodes = j;
-        
-        k = individual_depth(pop->ind + i);
-        s->totaldepth += k;
-        if (k < s->mindepth) s->mindepth = k;
-        if (k > s->maxdepth) s->maxdepth = k;
-        
-        l = pop->ind[i].hits;
-        s->totalhits += l;
-        if (l < s->minhits) s->minhits = l;
-        if (l > s->maxhits) s->maxhits = l;
-        
-        s->totalfit += pop->ind[i].a_fitness;
-        if (pop->ind[i].a_fitness > s->bestfit)
-        {
-            s->bestfit = pop->ind[i].a_fitness;
-            s->bestnodes = j;
-            s->bestdepth = k;
-            s->besthits = l;
-        } else if (pop->ind[i].a_fitness < s->worstfit)
-        {
-            s->worstfit = pop->ind[i].a_fitness;
-            s->worstnodes = j;
-            s->worstdepth = k;
-            s->worsthits = l;
-        }
-        
-        /** insert the current individual into the top N list
-      (if it belongs there). **/
-        
-        for (j = b; j > 0; --j)
-        {
-            if (pop->ind[i].a_fitness < temp[j - 1]->a_fitness)
-                break;
-            temp[j] = temp[j - 1];
-        }
-        if (j < s->bestn)
-            temp[j] = pop->ind + i;
-        if (b < s->bestn)
-            ++b;
-    }
+    for (b = 0; b < sum->tops; ++b)
+        temp[b] = pop->ind + sum->top[b];
+    free_pop_summary(sum);
     
     /** now save copies of the individuals in the "temp" list **/
     for (i = 0; i < b; ++i)
@@ -790,8 +1183,8 @@ void calculate_pop_stats(popstats* s, population* pop, int gen,
         shp->ind = (individual*) MALLOC(sizeof(individual));
         shp->ind->tr = (tree*) MALLOC(tree_count * sizeof(tree));
         duplicate_individual(shp->ind, temp[i]);
-        for (j = 0; j < tree_count; ++j)
-            reference_ephem_constants(shp->ind->tr[j].data, 1);
+        /* saved copies are never bred from, so need no spine. */
+        release_lineage(shp->ind);
         shp->refcount = 1;
         shp->next = NULL;
         
@@ -804,8 +1197,8 @@ void calculate_pop_stats(popstats* s, population* pop, int gen,
 
 #ifdef DEBUG
     printf ( "the best list is:\n" );
-    for ( j = 0; j < s->bestn; ++j )
-      printf ( "     %08x  %lf\n", s->best[j], s->best[j]->ind->a_fitness );
+    for ( i = 0; i < s->bestn; ++i )
+      printf ( "     %08x  %lf\n", s->best[i], s->best[i]->ind->a_fitness );
 #endif
     
     FREE(temp);
@@ -963,12 +1356,9 @@ void saved_individual_gc(void)
         {
             /** found one that needs to be deleted. **/
             
-            /* dereference its trees' ERCs and delete the trees. */
+            /* delete the trees. */
             for (j = 0; j < tree_count; ++j)
-            {
-                reference_ephem_constants(shp->ind->tr[j].data, -1);
                 free_tree(shp->ind->tr + j);
-            }
             FREE(shp->ind->tr);
             FREE(shp->ind);
             
@@ -997,7 +1387,7 @@ void saved_individual_gc(void)
  * an index translating indices to addresses.
  */
 
-saved_ind** read_saved_individuals(ephem_const** eind, FILE* f)
+saved_ind** read_saved_individuals(DATATYPE* eind, FILE* f)
 {
     char* buffer;
     int count;
@@ -1047,7 +1437,7 @@ saved_ind** read_saved_individuals(ephem_const** eind, FILE* f)
  * read the overall run statistics structures from a checkpoint file.
  */
 
-void read_stats_checkpoint(multipop* mpop, ephem_const** eind, FILE* f)
+void read_stats_checkpoint(multipop* mpop, DATATYPE* eind, FILE* f)
 {
     int i, j, k;
     saved_ind** sind;
@@ -1105,7 +1495,7 @@ void read_stats_checkpoint(multipop* mpop, ephem_const** eind, FILE* f)
  * an index for translating saved_ind addresses to integer indices.
  */
 
-saved_ind** write_saved_individuals(ephem_index* eind, FILE* f)
+saved_ind** write_saved_individuals(FILE* f)
 {
     saved_ind** index;
     saved_ind* shp;
@@ -1124,7 +1514,7 @@ saved_ind** write_saved_individuals(ephem_index* eind, FILE* f)
     {
         /* write the reference count and individual. */
         fprintf(f, "%d ", shp->refcount);
-        write_individual(shp->ind, eind, f);
+        write_individual(shp->ind, f);
         
         /* record the address in the index. */
         index[i++] = shp;
@@ -1140,13 +1530,13 @@ saved_ind** write_saved_individuals(ephem_index* eind, FILE* f)
  * write the overall run statistics structures to a checkpoint file.
  */
 
-void write_stats_checkpoint(multipop* mpop, ephem_index* eind, FILE* f)
+void write_stats_checkpoint(multipop* mpop, FILE* f)
 {
     int i, j, k;
     saved_ind** sind;
     
     /* write and index the saved individuals list. */
-    sind = write_saved_individuals(eind, f);
+    sind = write_saved_individuals(f);
     
     for (i = 0; i < mpop->size + 1; ++i)
     {
@@ -1232,6 +1622,21 @@ globaldata* get_globaldata(void)
     return (retval);
 }
 
+/* set_globaldata()
+ *
+ * make g the calling thread's copy of 'g'.
+ */
+
+void set_globaldata(globaldata* g)
+{
+#ifdef POSIX_MT
+    pthread_setspecific(g_key, g);
+#endif
+#ifdef SOLARIS_MT
+    thr_setspecific(g_key, g);
+#endif
+}
+
 
 /*
  * initialize_threading()
@@ -1280,6 +1685,9 @@ void initialize_threading(void)
     pthread_attr_init(&pthread_attr);
     pthread_attr_setscope(&pthread_attr, PTHREAD_SCOPE_SYSTEM);
     
+    /* the stack evaluator keeps its stacks on the heap, but the batch
+       evaluator and the tree walks done while breeding still recurse as
+       deep as the trees go, so the workers need room for deep trees. */
     if (1)
     {
         size_t size;
@@ -1313,65 +1721,87 @@ void initialize_threading(void)
     thr_setconcurrency( numthreads );
 #endif
 
+    /* how evaluation work is handed out to the threads. */
+    eval_grain = atoi(get_parameter("eval.grain"));
+    if (eval_grain < 1)
+    {
+        error(E_FATAL_ERROR, "eval.grain must be > 0");
+    }
+    eval_largest_first = atoi(get_parameter("eval.largest_first"));
+#ifdef COEVOLUTION
+    /* individuals are evaluated in pairs. */
+    eval_grain = (eval_grain + 1) / 2;
+#endif
+
+#ifdef POSIX_MT
+    /* give every worker its own random stream and generation spaces, then
+       start the workers once; every generation reuses them. */
+    initialize_random_streams(numthreads);
+    initialize_thread_genspace(numthreads);
+    initialize_tree_arenas(numthreads);
+    start_worker_pool(numthreads, &pthread_attr);
+#endif
+
+}
+
+/*
+ * free_threading()
+ *
+ * Stop the worker threads and release what initialize_threading() set up.
+ */
+
+void free_threading(void)
+{
+#ifdef POSIX_MT
+    stop_worker_pool();
+    free_random_streams();
+    free_thread_genspace();
+    pthread_attr_destroy(&pthread_attr);
+    free(pthread_getspecific(g_key));
+    pthread_setspecific(g_key, NULL);
+    pthread_key_delete(g_key);
+#endif
 }
 
 /* evaluate_pop_chuck()
  *
- * Called from evaluate_pop to do a chunk of evaluations on a pop.
- * This was done to allow multithreading.
+ * Run on each pool worker by evaluate_pop to do one chunk of evaluations
+ * on a pop.  This was done to allow multithreading.
  */
 
-void* evaluate_pop_chunk(void* param)
+void evaluate_pop_chunk(int thread, void* param)
 {
-    int k, startidx, endidx;
+    int i, k, first, last;
     population* pop;
-    globaldata* g;
     struct thread_param_t* t_param;
     
     t_param = (struct thread_param_t*) param;
     pop = t_param->pop;
-    startidx = t_param->startidx;
-    endidx = t_param->endidx;
-
-#ifdef POSIX_MT
-    pthread_setspecific(g_key, &t_param->g);
-#endif
-#ifdef SOLARIS_MT
-    thr_setspecific(g_key, &t_param->g);
-#endif
-    
-    g = get_globaldata();
     
-    /* printf("START: %d,%d\n", startidx, endidx); */
-
-#ifdef COEVOLUTION            /* Here we hack it to provide *two* individuals */
+    *(get_globaldata()) = t_param->g;
     
-    if ((endidx-startidx)%2)  /* it it's not even */
-  
-      {
-        char xx[256];
-        sprintf(xx,"Uneven number of individuals (%d) at %d",
-            endidx-startidx,startidx);
-        error ( E_FATAL_ERROR,xx);
-      }
-  
-    for ( k = startidx; k < endidx; k+=2 )
-      
-      /* It's GOT to have even number of inds */
-  
-      if ( pop->ind[k].evald != EVAL_CACHE_VALID ||
-       pop->ind[k+1].evald != EVAL_CACHE_VALID )
+    /* keep claiming units of work until the list runs out. */
+    while ((first = atomic_fetch_add(&t_param->next, t_param->grain)) <
+           t_param->count)
+    {
+        last = first + t_param->grain;
+        if (last > t_param->count) last = t_param->count;
+        
+        for (i = first; i < last; ++i)
         {
-      app_eval_fitness ( (pop->ind)+k, (pop->ind)+(k+1) );
-        }
+            k = t_param->order[i];
+#ifdef COEVOLUTION            /* Here we hack it to provide *two* individuals */
+            app_eval_fitness ( (pop->ind)+k, (pop->ind)+(k+1) );
 #else
-    for (k = startidx; k < endidx; ++k)
-        if (pop->ind[k].evald != EVAL_CACHE_VALID)
-        {
-            app_eval_fitness((pop->ind) + k);
-        }
+            if (i < t_param->evals)
+                evaluate_individual((pop->ind) + k);
+            if (t_param->part)
+                add_to_pop_summary(t_param->part[thread], pop, k);
 #endif
-
+        }
+    }
+    
+    (void) thread;
 }
 
 #endif /* !defined(POSIX_MT) && !defined(SOLARIS_MT) */
@@ -110,27 +110,71 @@ int individual_depth ( individual *ind )
 
      for ( j = 0; j < tree_count; ++j )
      {
-          if ( ( i = tree_depth ( ind->tr[j].data ) ) > k )
+          if ( ( i = ind->tr[j].depth ) > k )
                k = i;
      }
      return k;
 }
      
+/* individual_hash()
+ *
+ * returns a hash of all the individual's trees.  see tree_hash().
+ */
+
+unsigned long long individual_hash ( individual *ind )
+{
+     unsigned long long h = 14695981039346656037ULL;
+     int j;
+
+     for ( j = 0; j < tree_count; ++j )
+     {
+          h = (h ^ (unsigned long long)(j+1)) * 1099511628211ULL;
+          h = tree_hash ( ind->tr[j].data, h );
+     }
+     return h;
+}
+
 /* duplicate_individual()
  *
  * duplicates an individual.
  */
 
 void duplicate_individual ( individual *to, individual *from )
+{
+     duplicate_individual_except ( to, from, -1 );
+}
+
+/* duplicate_individual_except()
+ *
+ * duplicates an individual, except that tree "skip" is left empty for
+ * the caller to fill in.  breeding uses this so the tree it is about to
+ * replace is never copied into the new population's arena.
+ */
+
+void duplicate_individual_except ( individual *to, individual *from, int skip )
 {
      int j;
      for ( j = 0; j < tree_count; ++j )
-          copy_tree ( to->tr+j, from->tr+j );
+          if ( j == skip )
+          {
+               to->tr[j].data = NULL;
+               to->tr[j].offsets = NULL;
+               to->tr[j].inarena = 0;
+               to->tr[j].size = -1;
+               to->tr[j].nodes = -1;
+               to->tr[j].internal = -1;
+               to->tr[j].depth = -1;
+          }
+          else
+               copy_tree ( to->tr+j, from->tr+j );
      to->r_fitness = from->r_fitness;
      to->s_fitness = from->s_fitness;
      to->a_fitness = from->a_fitness;
      to->hits = from->hits;
      to->evald = from->evald;
      to->flags = from->flags;
+     /* the copy shares the spine saved when "from" was evaluated. */
+     clear_lineage ( to );
+     to->ln.own = retain_spine ( from->ln.own );
 }
 
@@ -35,9 +35,6 @@ FILE *mlog;
 /* do we dup OUT_SYS to stdout? */
 int quietmode = 0;
 
-/* tree generation spaces. */
-genspace gensp[GENSPACE_COUNT];
-
 /* internal copy of function set(s). */
 function_set* fset;
 int fset_count;
@@ -103,6 +100,9 @@ int main(int argc, char** argv)
     /* read parameters limiting tree node count and/or depth. */
     read_tree_limits();
     
+    /* pick the tree evaluator. */
+    initialize_evaluation();
+    
     /* if not starting from a checkpoint, seed the random number generator. */
     if (!startfromcheckpoint)
         initialize_random();
@@ -115,6 +115,13 @@ int main(int argc, char** argv)
     if (app_initialize(startfromcheckpoint))
         error(E_FATAL_ERROR, "app_initialize() failure.");
     
+    /* remember the fitness of recently evaluated programs. */
+    initialize_fitness_cache();
+    
+    /* remember the values of common subtrees for the batch evaluator. */
+    initialize_subtree_memo();
+    initialize_spines();
+    
     /* if not starting from a checkpoint, create a random population. */
     if (!startfromcheckpoint)
         mpop = initial_multi_population();
@@ -129,13 +136,21 @@ int main(int argc, char** argv)
     
     /* free app stuff. */
     app_uninitialize();
+
+#if defined(POSIX_MT) || defined(SOLARIS_MT)
+    /* shut down the worker threads. */
+    free_threading();
+#endif
     
     /* free lots of stuff. */
     free_breeding(mpop);
     free_topology(mpop);
     free_multi_population(mpop);
+    free_tree_arenas();
+    free_fitness_cache();
+    free_subtree_memo();
+    free_evaluation();
     free_parameters();
-    free_ephem_const();
     free_genspace();
     free_function_sets();
     
@@ -244,6 +259,7 @@ int function_sets_init(function_set* user_fset, int user_fcount,
                 
                 /* copy some stuff over. */
                 cur->code = user_fset[i].cset[j].code;
+                cur->vcode = user_fset[i].cset[j].vcode;
                 cur->ephem_gen = user_fset[i].cset[j].ephem_gen;
                 cur->ephem_str = user_fset[i].cset[j].ephem_str;
                 cur->arity = user_fset[i].cset[j].arity;
@@ -341,6 +357,7 @@ int function_sets_init(function_set* user_fset, int user_fcount,
                 
                 /* copy stuff. */
                 cur->code = user_fset[i].cset[j].code;
+                cur->vcode = user_fset[i].cset[j].vcode;
                 cur->ephem_gen = user_fset[i].cset[j].ephem_gen;
                 cur->ephem_str = user_fset[i].cset[j].ephem_str;
                 cur->arity = user_fset[i].cset[j].arity;
@@ -689,9 +706,11 @@ void pre_parameter_defaults(void)
 {
     add_parameter("output.basename", "lilgp", PARAM_COPY_NONE);
     add_parameter("output.stt_interval", "1", PARAM_COPY_NONE);
+    add_parameter("output.stt_binary", "on", PARAM_COPY_NONE);
     add_parameter("output.detail", "50", PARAM_COPY_NONE);
     add_parameter("output.bestn", "1", PARAM_COPY_NONE);
     add_parameter("output.digits", "4", PARAM_COPY_NONE);
+    add_parameter("output.buffer_size", "256", PARAM_COPY_NONE);
     
     add_parameter("init.method", "half_and_half",
                   PARAM_COPY_NONE);
@@ -703,6 +722,15 @@ void pre_parameter_defaults(void)
     
     /* default problem uses a single population. */
     add_parameter("multiple.subpops", "1", PARAM_COPY_NONE);
+    
+    /* individuals each evaluation thread takes at a time. */
+    add_parameter("eval.grain", "4", PARAM_COPY_NONE);
+    add_parameter("eval.cache_size", "65536", PARAM_COPY_NONE);
+    add_parameter("eval.memo_size", "32", PARAM_COPY_NONE);
+    add_parameter("eval.memo_min_nodes", "2", PARAM_COPY_NONE);
+    add_parameter("eval.spine_size", "64", PARAM_COPY_NONE);
+    add_parameter("eval.spine_depth", "3", PARAM_COPY_NONE);
+    add_parameter("eval.bound_quantile", "0", PARAM_COPY_NONE);
 }
 
 /* post_parameter_defaults()
@@ -715,6 +743,8 @@ void pre_parameter_defaults(void)
 void post_parameter_defaults(void)
 {
     binary_parameter("probabilistic_operators", 1);
+    binary_parameter("eval.largest_first", 1);
+    binary_parameter("eval.stack", 1);
 }
 
 /* process_commandline()
@@ -835,11 +865,14 @@ int process_commandline(int argc, char** argv, int* gen,
 
 void output_system_stats(event* t_total, event* t_eval, event* t_breed)
 {
+#ifdef TRACK_MEMORY
     int total, free, max, mallocc, reallocc, freec;
-    int ercused, ercfree, ercblocks, ercalloc;
+#endif
+    int ercused;
+    long lookups, found;
     int i;
     
-    get_ephem_stats(&ercused, &ercfree, &ercblocks, &ercalloc);
+    get_ephem_stats(&ercused);
     
     oprintf(OUT_SYS, 30, "\nSYSTEM STATISTICS\n");
 
@@ -877,10 +910,34 @@ void output_system_stats(event* t_total, event* t_eval, event* t_breed)
     if (ercused > 0)
     {
         oprintf(OUT_SYS, 30, "\n------- ephemeral random constants -------\n");
-        oprintf(OUT_SYS, 30, "                used:      %d\n", ercused);
-        oprintf(OUT_SYS, 30, "               freed:      %d\n", ercfree);
-        oprintf(OUT_SYS, 30, "           allocated:      %d\n", ercalloc);
-        oprintf(OUT_SYS, 30, "              blocks:      %d\n", ercblocks);
+        oprintf(OUT_SYS, 30, "           generated:      %d\n", ercused);
+    }
+    
+    /* if the fitness cache was used, show how well it did. */
+    get_fitness_cache_stats(&lookups, &found);
+    if (lookups > 0)
+    {
+        oprintf(OUT_SYS, 30, "\n------- fitness cache -------\n");
+        oprintf(OUT_SYS, 30, "             lookups:      %ld\n", lookups);
+        oprintf(OUT_SYS, 30, "                hits:      %ld\n", found);
+    }
+    
+    /* likewise for the subtree memo. */
+    get_subtree_memo_stats(&lookups, &found);
+    if (lookups > 0)
+    {
+        oprintf(OUT_SYS, 30, "\n------- subtree memo -------\n");
+        oprintf(OUT_SYS, 30, "             lookups:      %ld\n", lookups);
+        oprintf(OUT_SYS, 30, "                hits:      %ld\n", found);
+    }
+    
+    /* and for the columns offspring took from their parents' spines. */
+    get_spine_stats(&found, &lookups);
+    if (found + lookups > 0)
+    {
+        oprintf(OUT_SYS, 30, "\n------- spines -------\n");
+        oprintf(OUT_SYS, 30, "     columns reused:      %ld\n", found);
+        oprintf(OUT_SYS, 30, "   columns computed:      %ld\n", lookups);
     }
 }
 
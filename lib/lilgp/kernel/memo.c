@@ -0,0 +1,365 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+#include <stdatomic.h>
+
+#ifdef POSIX_MT
+#include <pthread.h>
+#endif
+
+/* the subtree memo.  crossover copies most of each parent into its
+ * offspring, so the same subtrees turn up in many members of a population.
+ * the batch evaluator asks here before evaluating a subtree over a block
+ * of fitness cases, and if the column of values for that subtree and
+ * block is remembered it is copied out instead of being recomputed.
+ *
+ * the table is direct mapped.  a subtree is only given a column the second
+ * time it is seen, so one-off subtrees cost a slot but no column.  every
+ * hit bumps an entry's use count and every other subtree landing on the
+ * slot wears it down; an entry is replaced once its count reaches zero, so
+ * frequently used subtrees stay put.  the column data is limited to
+ * "eval.memo_size" megabytes in total, and subtrees with fewer than
+ * "eval.memo_min_nodes" nodes are cheaper to evaluate than to look up and
+ * are never memoized.  the memo is emptied at the start of each
+ * generation.
+ */
+
+#define MEMO_LOCKS     64
+#define MEMO_MAXUSES   15
+
+/* nominal column length used to size the table from the byte limit. */
+#define MEMO_COLUMN    256
+
+typedef struct
+{
+     unsigned long long key;   /* 0 marks an empty slot */
+     void *cases;
+     int first;
+     int count;
+     int span;                 /* lnodes in the subtree, as a collision guard */
+     int uses;
+     DATATYPE *data;           /* NULL until the subtree is seen again */
+} memo_entry;
+
+static memo_entry *table = NULL;
+static unsigned long slot_mask = 0;
+static long limit = 0;
+static atomic_long used;
+static int min_nodes = 1;
+static long lookups[MEMO_LOCKS];
+static long found[MEMO_LOCKS];
+
+#ifdef POSIX_MT
+static pthread_mutex_t locks[MEMO_LOCKS];
+#define LOCK(s)   pthread_mutex_lock ( locks+((s)%MEMO_LOCKS) )
+#define UNLOCK(s) pthread_mutex_unlock ( locks+((s)%MEMO_LOCKS) )
+#else
+#define LOCK(s)
+#define UNLOCK(s)
+#endif
+
+#define HASH_PRIME 1099511628211ULL
+#define HASH_BASIS 14695981039346656037ULL
+
+/* initialize_subtree_memo()
+ *
+ * reads the "eval.memo_size" (megabytes of column data, zero turns the
+ * memo off) and "eval.memo_min_nodes" parameters and builds the table.
+ */
+
+void initialize_subtree_memo ( void )
+{
+     long size;
+     unsigned long slots;
+#ifdef POSIX_MT
+     int i;
+#endif
+
+     size = atol ( get_parameter ( "eval.memo_size" ) );
+     if ( size < 0 )
+          error ( E_FATAL_ERROR, "eval.memo_size must be >= 0" );
+     min_nodes = atoi ( get_parameter ( "eval.memo_min_nodes" ) );
+     if ( min_nodes < 2 )
+          error ( E_FATAL_ERROR, "eval.memo_min_nodes must be >= 2" );
+     if ( size == 0 )
+          return;
+
+     limit = size * 1024 * 1024;
+     for ( slots = 1; slots * MEMO_COLUMN * sizeof ( DATATYPE ) <
+           (unsigned long)limit; slots *= 2 );
+     slot_mask = slots-1;
+
+     table = (memo_entry *)MALLOC ( slots * sizeof ( memo_entry ) );
+     memset ( table, 0, slots * sizeof ( memo_entry ) );
+     atomic_init ( &used, 0 );
+     memset ( lookups, 0, sizeof ( lookups ) );
+     memset ( found, 0, sizeof ( found ) );
+
+#ifdef POSIX_MT
+     for ( i = 0; i < MEMO_LOCKS; ++i )
+          pthread_mutex_init ( locks+i, NULL );
+#endif
+
+     oprintf ( OUT_SYS, 30, "    subtree memo of %ld MB, %lu slots.\n",
+               size, slots );
+}
+
+/* free_subtree_memo()
+ *
+ * frees the table and all the columns.
+ */
+
+void free_subtree_memo ( void )
+{
+#ifdef POSIX_MT
+     int i;
+#endif
+
+     if ( table == NULL )
+          return;
+
+     clear_subtree_memo();
+#ifdef POSIX_MT
+     for ( i = 0; i < MEMO_LOCKS; ++i )
+          pthread_mutex_destroy ( locks+i );
+#endif
+     FREE ( table );
+     table = NULL;
+}
+
+/* clear_subtree_memo()
+ *
+ * forgets every remembered column.  must not be called while the
+ * population is being evaluated.
+ */
+
+void clear_subtree_memo ( void )
+{
+     unsigned long i;
+
+     if ( table == NULL )
+          return;
+
+     for ( i = 0; i <= slot_mask; ++i )
+          if ( table[i].data )
+               FREE ( table[i].data );
+     memset ( table, 0, ( slot_mask + 1 ) * sizeof ( memo_entry ) );
+     atomic_store ( &used, 0 );
+}
+
+/* subtree_memo_enabled()
+ *
+ * returns 1 if the memo is turned on.
+ */
+
+int subtree_memo_enabled ( void )
+{
+     return table != NULL;
+}
+
+/* get_subtree_memo_stats()
+ *
+ * returns the number of lookups and how many of them were hits.
+ */
+
+void get_subtree_memo_stats ( long *l, long *f )
+{
+     int i;
+
+     *l = *f = 0;
+     for ( i = 0; i < MEMO_LOCKS; ++i )
+     {
+          *l += lookups[i];
+          *f += found[i];
+     }
+}
+
+/* memo_hash_tree()
+ *
+ * fills in, for every lnode that starts a subtree of the tree, the
+ * subtree's hash, its length in lnodes, and whether it has enough nodes to
+ * be worth memoizing.  the arrays are indexed by offset from the root.
+ * unlike tree_hash(), each node's hash is built from its children's, so
+ * the whole tree is covered in one pass and a subtree hashes the same
+ * wherever it appears.  only trees that evaluate_batch_capable() accepts
+ * (no skip nodes) may be passed.
+ */
+
+static unsigned long long memo_hash_recurse ( lnode **l, lnode *base,
+                                             unsigned long long *hash,
+                                             int *span, char *worth,
+                                             int *nodes )
+{
+     function *f = (**l).f;
+     int p = *l - base;
+     unsigned long long h = HASH_BASIS;
+     unsigned char *c;
+     int i, n = 1;
+
+     ++*l;
+     h = ( h ^ (unsigned long long)(f->index+1) ) * HASH_PRIME;
+
+     if ( f->arity == 0 )
+     {
+          if ( f->ephem_gen )
+          {
+               c = (unsigned char *)&((**l).d);
+               for ( i = 0; i < (int)sizeof ( DATATYPE ); ++i )
+                    h = ( h ^ c[i] ) * HASH_PRIME;
+               ++*l;
+          }
+     }
+     else
+          for ( i = 0; i < f->arity; ++i )
+          {
+	       /* fold in each child's hash, scrambling so order matters. */
+               h = ( h ^ memo_hash_recurse ( l, base, hash, span, worth,
+                                             &n ) ) * HASH_PRIME;
+               h ^= h >> 29;
+          }
+
+     if ( h == 0 )
+          h = 1;
+     hash[p] = h;
+     span[p] = *l - base - p;
+     worth[p] = n >= min_nodes;
+     *nodes += n;
+     return h;
+}
+
+void memo_hash_tree ( lnode *tree, unsigned long long *hash, int *span,
+                      char *worth )
+{
+     lnode *l = tree;
+     int n = 0;
+     memo_hash_recurse ( &l, tree, hash, span, worth, &n );
+}
+
+/* memo_key(), memo_slot()
+ *
+ * folds the tree number into a subtree's hash and picks its slot.
+ */
+
+static unsigned long long memo_key ( unsigned long long hash, int whichtree )
+{
+     hash = ( hash ^ (unsigned long long)whichtree ) * HASH_PRIME;
+     return hash ? hash : 1;
+}
+
+static unsigned long memo_slot ( unsigned long long key, batchinfo *b )
+{
+     key ^= (unsigned long long)b->first * HASH_PRIME;
+     return (unsigned long)( key ^ ( key >> 32 ) ) & slot_mask;
+}
+
+/* memo_lookup()
+ *
+ * looks for the column of a subtree over the block of cases b.  on a hit
+ * the values are copied to out and MEMO_HIT is returned.  MEMO_ADMIT means
+ * the subtree has been seen before and the caller should pass its values
+ * to memo_store() once they are evaluated; MEMO_MISS means it should not.
+ */
+
+int memo_lookup ( unsigned long long hash, int span, int whichtree,
+                  batchinfo *b, DATATYPE *out )
+{
+     unsigned long long key = memo_key ( hash, whichtree );
+     unsigned long s = memo_slot ( key, b );
+     memo_entry *e = table + s;
+     int r = MEMO_MISS;
+
+     LOCK(s);
+     ++lookups[s%MEMO_LOCKS];
+     if ( e->key == key && e->span == span && e->cases == b->cases &&
+          e->first == b->first && e->count == b->count )
+     {
+          if ( e->data )
+          {
+               memcpy ( out, e->data, b->count * sizeof ( DATATYPE ) );
+               if ( e->uses < MEMO_MAXUSES )
+                    ++e->uses;
+               ++found[s%MEMO_LOCKS];
+               r = MEMO_HIT;
+          }
+          else
+               r = MEMO_ADMIT;
+     }
+     else if ( e->data && e->uses > 0 )
+	  /* somebody else's popular subtree:  wear it down a little. */
+          --e->uses;
+     else
+     {
+	  /* take over the slot, remembering only that we were here. */
+          if ( e->data )
+          {
+               FREE ( e->data );
+               atomic_fetch_sub ( &used, e->count * (long)sizeof ( DATATYPE ) );
+          }
+          e->key = key;
+          e->span = span;
+          e->cases = b->cases;
+          e->first = b->first;
+          e->count = b->count;
+          e->uses = 0;
+          e->data = NULL;
+     }
+     UNLOCK(s);
+
+     return r;
+}
+
+/* memo_store()
+ *
+ * remembers the values of a subtree for which memo_lookup() returned
+ * MEMO_ADMIT, if the slot has not been taken over since and the column
+ * fits within the memory limit.
+ */
+
+void memo_store ( unsigned long long hash, int span, int whichtree,
+                  batchinfo *b, DATATYPE *values )
+{
+     unsigned long long key = memo_key ( hash, whichtree );
+     unsigned long s = memo_slot ( key, b );
+     memo_entry *e = table + s;
+     long bytes = b->count * (long)sizeof ( DATATYPE );
+
+     LOCK(s);
+     if ( e->key == key && e->span == span && e->cases == b->cases &&
+          e->first == b->first && e->count == b->count && e->data == NULL )
+     {
+          if ( atomic_fetch_add ( &used, bytes ) + bytes <= limit )
+          {
+               e->data = (DATATYPE *)MALLOC ( bytes );
+               memcpy ( e->data, values, bytes );
+               e->uses = 1;
+          }
+          else
+               atomic_fetch_sub ( &used, bytes );
+     }
+     UNLOCK(s);
+}
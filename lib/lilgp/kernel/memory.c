@@ -27,33 +27,139 @@
 
 #include <lilgp.h>
 
+#ifdef TRACK_MEMORY
+
+#include <stdatomic.h>
+#ifdef POSIX_MT
+#include <pthread.h>
+#endif
+
 #ifdef MEMORY_LOG
 extern FILE *mlog;
 #endif
 
-static int totalalloc = 0;
-static int maxalloc   = 0;
-static int freealloc  = 0;
-static int curalloc   = 0;
-static int malloccalls = 0;
-static int freecalls = 0;
-static int realloccalls = 0;
+/* the statistics are kept per thread, so allocating never touches a
+ * counter another thread writes to.  each thread's record is only ever
+ * written by that thread; relaxed atomic loads and stores make it safe for
+ * get_memory_stats() to read the records while they change, without the
+ * cost of locked read-modify-write instructions.  curalloc of a single
+ * thread can go negative when it frees memory another thread allocated;
+ * only the sum over all threads is meaningful.
+ */
+
+typedef struct _memcounters
+{
+     atomic_long totalalloc;
+     atomic_long freealloc;
+     atomic_long curalloc;
+     atomic_long malloccalls;
+     atomic_long freecalls;
+     atomic_long realloccalls;
+     struct _memcounters *next;
+} memcounters;
+
+static memcounters *all_counters = NULL;
+static _Thread_local memcounters *my_counters = NULL;
+static atomic_long maxalloc = 0;
+
+#ifdef POSIX_MT
+static pthread_mutex_t counters_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#define BUMP(c,n) atomic_store_explicit ( &(c), \
+          atomic_load_explicit ( &(c), memory_order_relaxed ) + (n), \
+          memory_order_relaxed )
+#define READ(c) atomic_load_explicit ( &(c), memory_order_relaxed )
+
+/* get_counters()
+ *
+ * returns the calling thread's counters, creating and registering them
+ * the first time the thread allocates.  they are never freed, so the
+ * counts of threads that have exited still show up in the totals.
+ */
+
+static memcounters *get_counters ( void )
+{
+     memcounters *c;
+
+     if ( my_counters )
+          return my_counters;
+
+     c = (memcounters *)calloc ( 1, sizeof ( memcounters ) );
+     if ( c == NULL )
+          error ( E_FATAL_ERROR, "cannot allocate memory counters." );
+#ifdef POSIX_MT
+     pthread_mutex_lock ( &counters_lock );
+#endif
+     c->next = all_counters;
+     all_counters = c;
+#ifdef POSIX_MT
+     pthread_mutex_unlock ( &counters_lock );
+#endif
+     my_counters = c;
+     return c;
+}
+
+/* sample_memory_stats()
+ *
+ * adds up the bytes currently allocated by every thread and updates the
+ * high-water mark.  with per-thread counters there is no global total to
+ * compare against on every allocation, so the maximum is only as good as
+ * the sampling:  this is called right before each generation's old
+ * population is freed, when memory use peaks, and by get_memory_stats().
+ */
+
+void sample_memory_stats ( void )
+{
+     memcounters *c;
+     long cur = 0;
+
+#ifdef POSIX_MT
+     pthread_mutex_lock ( &counters_lock );
+#endif
+     for ( c = all_counters; c; c = c->next )
+          cur += READ(c->curalloc);
+#ifdef POSIX_MT
+     pthread_mutex_unlock ( &counters_lock );
+#endif
+     if ( cur > atomic_load ( &maxalloc ) )
+          atomic_store ( &maxalloc, cur );
+}
 
 /* get_memory_stats()
  *
- * returns the memory statistics stored in static global
- * variables.
+ * adds up the memory statistics of all threads.
  */
 
 void get_memory_stats ( int *total, int *free, int *max,
                        int *mallocc, int *reallocc, int *freec )
 {
-     *total = totalalloc;
-     *free = freealloc;
-     *max = maxalloc;
-     *mallocc = malloccalls;
-     *reallocc = realloccalls;
-     *freec = freecalls;
+     memcounters *c;
+     long t = 0, f = 0, m = 0, r = 0, fc = 0;
+
+     sample_memory_stats();
+
+#ifdef POSIX_MT
+     pthread_mutex_lock ( &counters_lock );
+#endif
+     for ( c = all_counters; c; c = c->next )
+     {
+          t += READ(c->totalalloc);
+          f += READ(c->freealloc);
+          m += READ(c->malloccalls);
+          r += READ(c->realloccalls);
+          fc += READ(c->freecalls);
+     }
+#ifdef POSIX_MT
+     pthread_mutex_unlock ( &counters_lock );
+#endif
+
+     *total = (int)t;
+     *free = (int)f;
+     *max = (int)atomic_load ( &maxalloc );
+     *mallocc = (int)m;
+     *reallocc = (int)r;
+     *freec = (int)fc;
 }
 
 /* track_malloc()
@@ -64,6 +170,7 @@ void get_memory_stats ( int *total, int *free, int *max,
 void *track_malloc ( unsigned long size )
 {
      unsigned char *p;
+     memcounters *c;
 
      if ( size == 0 )
           return NULL;
@@ -71,11 +178,10 @@ void *track_malloc ( unsigned long size )
      p = (unsigned char *)malloc ( size+EXTRAMEM );
      if ( p == NULL )
           return NULL;
-     ++malloccalls;
-     totalalloc += size;
-     curalloc += size;
-     if ( curalloc > maxalloc )
-          maxalloc = curalloc;
+     c = get_counters();
+     BUMP(c->malloccalls, 1);
+     BUMP(c->totalalloc, size);
+     BUMP(c->curalloc, size);
      *(int *)p = size;
 #ifdef MEMORY_LOG
      fprintf ( mlog, "MALLOC %d %08x\n", size, (void *)(p+EXTRAMEM) );
@@ -93,6 +199,7 @@ void *track_malloc ( unsigned long size )
 void track_free ( void *p )
 {
      int size;
+     memcounters *c;
 
      if ( p == NULL )
           return;
@@ -104,9 +211,10 @@ void track_free ( void *p )
      
      size = *(int *)((unsigned char *)p-EXTRAMEM);
 
-     ++freecalls;
-     curalloc -= size;
-     freealloc += size;
+     c = get_counters();
+     BUMP(c->freecalls, 1);
+     BUMP(c->curalloc, -size);
+     BUMP(c->freealloc, size);
 
      free ( (unsigned char *)p-EXTRAMEM );
 }
@@ -120,6 +228,7 @@ void track_free ( void *p )
 void *track_realloc ( void *p, int newsize )
 {
      int size, change;
+     memcounters *c;
 
      if ( p == NULL )
           return MALLOC ( newsize );
@@ -127,14 +236,13 @@ void *track_realloc ( void *p, int newsize )
      size = *(int *)((unsigned char *)p-EXTRAMEM);
 
      change = newsize-size;
-     curalloc += change;
-     if ( curalloc > maxalloc )
-          maxalloc = curalloc;
+     c = get_counters();
+     BUMP(c->curalloc, change);
      if ( change > 0 )
-          totalalloc += change;
+          BUMP(c->totalalloc, change);
      else
-          freealloc -= change;
-     ++realloccalls;
+          BUMP(c->freealloc, -change);
+     BUMP(c->realloccalls, 1);
 
 #ifdef MEMORY_LOG
      fprintf ( mlog, "REALLOC %08x", p );
@@ -148,4 +256,4 @@ void *track_realloc ( void *p, int newsize )
      return (void *)((unsigned char *)p+EXTRAMEM);
 }
 
-
+#endif
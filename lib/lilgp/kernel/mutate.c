@@ -351,7 +351,6 @@ void operator_mutate ( population *oldpop, population *newpop,
      lnode *replace[2];
      int l, ns;
      int badtree;
-     int repcount;
      mutate_data * md;
      int t;
      double r;
@@ -366,12 +365,12 @@ void operator_mutate ( population *oldpop, population *newpop,
      total = md->internal + md->external;
 
      /* choose a tree to mutate. */
-     r = random_double(&globrand) * md->treetotal;
+     r = random_double(get_randomgen()) * md->treetotal;
      for ( t = 0; r >= md->tree[t]; ++t );
 
      /* select an individual to mutate. */
      p = md->sc->select_method ( md->sc ); 
-     ps = tree_nodes ( oldpop->ind[p].tr[t].data );
+     ps = oldpop->ind[p].tr[t].nodes;
      forceany = (ps==1||total==0.0);
 
 #ifdef DEBUG_MUTATE
@@ -387,20 +386,20 @@ void operator_mutate ( population *oldpop, population *newpop,
 	  if ( forceany )
 	  {
 	       /* choose any point. */
-	       l = random_int ( &globrand, ps );
-	       replace[0] = get_subtree ( oldpop->ind[p].tr[t].data, l );
+	       l = random_int ( get_randomgen(), ps );
+	       replace[0] = tree_point ( oldpop->ind[p].tr+t, l );
 	  }
-	  else if ( total*random_double(&globrand) < md->internal )
+	  else if ( total*random_double(get_randomgen()) < md->internal )
 	  {
 	       /* choose an internal point. */
-	       l = random_int ( &globrand, tree_nodes_internal ( oldpop->ind[p].tr[t].data ) );
-	       replace[0] = get_subtree_internal ( oldpop->ind[p].tr[t].data, l );
+	       l = random_int ( get_randomgen(), oldpop->ind[p].tr[t].internal );
+	       replace[0] = tree_point_internal ( oldpop->ind[p].tr+t, l );
 	  }
 	  else
 	  {
 	       /* choose an external point. */
-	       l = random_int ( &globrand, tree_nodes_external ( oldpop->ind[p].tr[t].data ) );
-	       replace[0] = get_subtree_external ( oldpop->ind[p].tr[t].data, l );
+	       l = random_int ( get_randomgen(), ps - oldpop->ind[p].tr[t].internal );
+	       replace[0] = tree_point_external ( oldpop->ind[p].tr+t, l );
 	  }
 	  
 #ifdef DEBUG_MUTATE
@@ -410,7 +409,7 @@ void operator_mutate ( population *oldpop, population *newpop,
 
           gensp_reset ( 1 );
 	  /* pick a value from the depth ramp. */
-          depth = md->mindepth + random_int ( &globrand, md->maxdepth - md->mindepth + 1 );
+          depth = md->mindepth + random_int ( get_randomgen(), md->maxdepth - md->mindepth + 1 );
 	  /* grow the tree. */
           switch ( md->method )
           {
@@ -424,7 +423,7 @@ void operator_mutate ( population *oldpop, population *newpop,
 					   replace[0]->f->return_type);
                break;
              case GENERATE_HALF_AND_HALF:
-               if ( random_double(&globrand) < 0.5 )
+               if ( random_double(get_randomgen()) < 0.5 )
                     generate_random_grow_tree ( 1, depth, fset+tree_map[t].fset,
 					   replace[0]->f->return_type);
                else
@@ -439,7 +438,8 @@ void operator_mutate ( population *oldpop, population *newpop,
 #endif
 
 	  /* count the nodes in the new tree. */
-          ns = ps - tree_nodes ( replace[0] ) + tree_nodes ( gensp[1].data );
+          ns = ps - point_nodes ( oldpop->ind[p].tr+t, replace[0] ) +
+               tree_nodes ( gensp[1].data );
           totalnodes = ns;
 
 	  /* check the mutated tree against node count and/or size limits. */
@@ -448,8 +448,7 @@ void operator_mutate ( population *oldpop, population *newpop,
                badtree = 1;
           else if ( tree_map[t].depthlimit > -1 )
           {
-               ns = tree_depth_to_subtree ( oldpop->ind[p].tr[t].data,
-                                           replace[0] ) +
+               ns = point_level ( oldpop->ind[p].tr+t, replace[0] ) +
                     tree_depth ( gensp[1].data );
                if ( ns > tree_map[t].depthlimit )
                     badtree = 1;
@@ -494,24 +493,22 @@ void operator_mutate ( population *oldpop, population *newpop,
 #ifdef DEBUG_MUTATE
                fprintf ( stderr, "new tree is permissible.\n" );
 #endif
-	       /* copy the parent tree to the offspring position. */
-               duplicate_individual ( (newpop->ind)+newpop->next,
-                                     (oldpop->ind)+p );
-	       /* free the tree selected for mutation. */
-               free_tree ( newpop->ind[newpop->next].tr+t );
+	       /* copy the parent to the offspring position, all but the
+		  tree selected for mutation. */
+               duplicate_individual_except ( (newpop->ind)+newpop->next,
+                                            (oldpop->ind)+p, t );
                
                /* copy the selected tree, replacing the subtree at the
 		  mutation point with the randomly generated tree. */
                replace[1] = gensp[1].data;
-               copy_tree_replace_many ( 0, oldpop->ind[p].tr[t].data,
-                                       replace, replace+1, 1, &repcount );
-               if ( repcount != 1 )
-               {
-                    error ( E_FATAL_ERROR,
-                           "botched mutation:  this can't happen." );
-               }
+               splice_tree ( 0, oldpop->ind[p].tr+t, t, replace[0], replace[1],
+                             gensp[1].used );
 	       /* copy the tree to the new individual. */
                gensp_dup_tree ( 0, newpop->ind[newpop->next].tr+t );
+               splice_lineage ( newpop->ind+newpop->next,
+                                replace[0] - oldpop->ind[p].tr[t].data,
+                                point_size ( oldpop->ind[p].tr+t, replace[0] ),
+                                gensp[1].used );
                newpop->ind[newpop->next].evald = EVAL_CACHE_INVALID;
                newpop->ind[newpop->next].flags = FLAG_NONE;
                
@@ -0,0 +1,209 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+#include <stdatomic.h>
+
+/* node offset tables.  choosing a crossover or mutation point means
+ * finding the k-th node (or the k-th function or terminal) of a tree, and
+ * checking the offspring against the limits means measuring the subtree
+ * found there and how deep it sits.  each of those is a walk over the
+ * tree, and with keep_trying set they can be repeated many times for one
+ * offspring.  get_tree_offsets() walks the tree once instead and keeps the
+ * answers in a table hung off the tree:  the lnode offset of every node,
+ * every function and every terminal in order, and for each offset that
+ * starts a subtree its node count, depth, length and level.
+ *
+ * a table is built the first time it is asked for.  for a member of the
+ * old population that can happen in several breeding threads at once;
+ * the first table to be finished is kept and the others are thrown away.
+ * the table is freed along with its tree.
+ */
+
+typedef struct
+{
+     int nodes;                /* nodes in the subtree starting here */
+     int depth;                /* its depth */
+     int size;                 /* its length in lnodes */
+     int level;                /* how far below the root it starts */
+} point_info;
+
+struct _tree_offsets
+{
+     point_info *point;        /* indexed by lnode offset */
+     int *any;                 /* offset of each node, in order */
+     int *internal;            /* ... of each function node */
+     int *external;            /* ... of each terminal node */
+     int anys, internals, externals;
+};
+
+/* build_offsets()
+ *
+ * walks a tree filling in its table.
+ */
+
+static void build_offsets_recurse ( lnode **l, lnode *base, int level,
+                                    tree_offsets *o )
+{
+     function *f = (**l).f;
+     point_info *p = o->point + ( *l - base );
+     point_info *c;
+     int i;
+
+     o->any[o->anys++] = *l - base;
+     p->nodes = 1;
+     p->depth = 0;
+     p->level = level;
+
+     ++*l;
+     if ( f->arity == 0 )
+     {
+          o->external[o->externals++] = p - o->point;
+          if ( f->ephem_gen )
+               ++*l;
+     }
+     else
+     {
+          o->internal[o->internals++] = p - o->point;
+          for ( i = 0; i < f->arity; ++i )
+          {
+	       /* skip the pointer over the skipsize node. */
+               if ( f->type == FUNC_EXPR || f->type == EVAL_EXPR )
+                    ++*l;
+               c = o->point + ( *l - base );
+               build_offsets_recurse ( l, base, level+1, o );
+               p->nodes += c->nodes;
+               if ( c->depth+1 > p->depth )
+                    p->depth = c->depth+1;
+          }
+     }
+
+     p->size = *l - base - ( p - o->point );
+}
+
+static tree_offsets *build_offsets ( tree *t )
+{
+     tree_offsets *o;
+     lnode *l = t->data;
+
+     /* the table, the point info and the node lists in one block. */
+     o = (tree_offsets *)MALLOC ( sizeof ( tree_offsets ) +
+                                  t->size * sizeof ( point_info ) +
+                                  2 * t->nodes * sizeof ( int ) );
+     o->point = (point_info *)( o+1 );
+     o->any = (int *)( o->point + t->size );
+     o->internal = o->any + t->nodes;
+     o->external = o->internal + t->internal;
+     o->anys = o->internals = o->externals = 0;
+
+     build_offsets_recurse ( &l, t->data, 0, o );
+     return o;
+}
+
+/* get_tree_offsets()
+ *
+ * returns the table for a tree, building it if it does not have one yet.
+ */
+
+tree_offsets *get_tree_offsets ( tree *t )
+{
+     tree_offsets * _Atomic *slot = (tree_offsets * _Atomic *)&t->offsets;
+     tree_offsets *o, *none = NULL;
+
+     o = atomic_load_explicit ( slot, memory_order_acquire );
+     if ( o )
+          return o;
+
+     o = build_offsets ( t );
+     if ( !atomic_compare_exchange_strong ( slot, &none, o ) )
+     {
+	  /* another thread got there first. */
+          FREE ( o );
+          o = none;
+     }
+     return o;
+}
+
+/* free_tree_offsets()
+ *
+ * frees a tree's table, if it has one.
+ */
+
+void free_tree_offsets ( tree *t )
+{
+     if ( t->offsets )
+          FREE ( t->offsets );
+     t->offsets = NULL;
+}
+
+/* tree_point(), tree_point_internal(), tree_point_external()
+ *
+ * like get_subtree(), get_subtree_internal() and get_subtree_external():
+ * return the k-th node, function node or terminal node of a tree, counting
+ * from zero in the order they are stored.
+ */
+
+lnode *tree_point ( tree *t, int k )
+{
+     return t->data + get_tree_offsets ( t )->any[k];
+}
+
+lnode *tree_point_internal ( tree *t, int k )
+{
+     return t->data + get_tree_offsets ( t )->internal[k];
+}
+
+lnode *tree_point_external ( tree *t, int k )
+{
+     return t->data + get_tree_offsets ( t )->external[k];
+}
+
+/* point_nodes(), point_depth(), point_size(), point_level()
+ *
+ * for a subtree of t, the same as tree_nodes(), tree_depth(), tree_size()
+ * and tree_depth_to_subtree() would return.
+ */
+
+int point_nodes ( tree *t, lnode *l )
+{
+     return get_tree_offsets ( t )->point[l - t->data].nodes;
+}
+
+int point_depth ( tree *t, lnode *l )
+{
+     return get_tree_offsets ( t )->point[l - t->data].depth;
+}
+
+int point_size ( tree *t, lnode *l )
+{
+     return get_tree_offsets ( t )->point[l - t->data].size;
+}
+
+int point_level ( tree *t, lnode *l )
+{
+     return get_tree_offsets ( t )->point[l - t->data].level;
+}
@@ -25,8 +25,16 @@
  *  
  */
 
+/* for fopencookie(). */
+#define _GNU_SOURCE
+
 #include <lilgp.h>
 
+#ifdef POSIX_MT
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
 char buffer[MAXMESSAGELENGTH];
 
 typedef struct
@@ -41,6 +49,15 @@ typedef struct
      int valid;
 
      char *buffer;
+
+#ifdef POSIX_MT
+     /* with a writer thread, f only copies text into the ring and the
+        writer moves it on to the file itself. */
+     FILE *out;
+     char *ring;
+     atomic_size_t head;       /* bytes ever put in the ring */
+     atomic_size_t tail;       /* bytes ever written out of it */
+#endif
 } output;
 
 output streams[MAXOUTPUTSTREAMS] =
@@ -49,7 +66,9 @@ output streams[MAXOUTPUTSTREAMS] =
        { OUT_PRG, ".prg", 0, "w", 0, NULL, 0 },
        { OUT_STT, ".stt", 0, "w", 0, NULL, 0 },
        { OUT_BST, ".bst", 1, "w", 0, NULL, 0 },
-       { OUT_HIS, ".his", 0, "w", 0, NULL, 0 } };
+       { OUT_HIS, ".his", 0, "w", 0, NULL, 0 },
+       { OUT_TIM, ".tim", 0, "w", 0, NULL, 0 },
+       { OUT_STB, ".stb", 0, "w", 0, NULL, 0 } };
      
 int output_stream_count = SYSOUTPUTSTREAMS;
 int toolate = 0;
@@ -60,6 +79,267 @@ char error_type[3][20] = { "WARNING: ", "ERROR: ", "FATAL ERROR: " };
 
 extern int quietmode;
 
+#ifdef POSIX_MT
+
+/* the writer thread.  when "output.buffer_size" is not zero, each stream
+ * that is opened gets a ring of that many kilobytes, and the FILE handed
+ * out for it is an unbuffered stream whose writes just copy into the ring.
+ * a single writer thread drains the rings to the files, so the GP threads
+ * do not wait on the disk unless a ring fills up.  everything written to a
+ * stream, by oputs() or straight to its FILE, goes through the same ring
+ * and stays in order.
+ *
+ * a ring has one writer and one reader (stdio's lock on the stream's FILE
+ * keeps writers in line), so text is passed on by bumping the head and
+ * tail counters.  the lock is only taken to wake the writer thread up or
+ * to wait for it.  flush_output_streams() asks the writer to flush the
+ * files when it has caught up; sync_output_streams() waits until it has.
+ */
+
+static size_t ring_size = 0;
+static pthread_t writer_id;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t drained = PTHREAD_COND_INITIALIZER;
+static atomic_int writer_sleeping;
+static atomic_int flush_wanted;
+static int writer_quit = 0;
+
+/* ring_pending()
+ *
+ * returns 1 if the writer thread has something to do.
+ */
+
+static int ring_pending ( void )
+{
+     int i;
+
+     if ( atomic_load ( &flush_wanted ) )
+          return 1;
+     for ( i = 0; i < output_stream_count; ++i )
+          if ( streams[i].ring &&
+               atomic_load ( &streams[i].head ) !=
+               atomic_load ( &streams[i].tail ) )
+               return 1;
+     return 0;
+}
+
+/* wake_writer()
+ *
+ * wakes the writer thread if it is waiting for work.
+ */
+
+static void wake_writer ( void )
+{
+     if ( !atomic_load ( &writer_sleeping ) )
+          return;
+     pthread_mutex_lock ( &writer_lock );
+     pthread_cond_signal ( &work );
+     pthread_mutex_unlock ( &writer_lock );
+}
+
+/* drain_ring()
+ *
+ * writes everything in a stream's ring to its file.  called by the writer
+ * thread holding io_lock.
+ */
+
+static void drain_ring ( output *s )
+{
+     size_t head = atomic_load ( &s->head );
+     size_t tail = atomic_load_explicit ( &s->tail, memory_order_relaxed );
+     size_t at, n;
+
+     if ( head == tail )
+          return;
+
+     while ( tail != head )
+     {
+          at = tail % ring_size;
+          n = head - tail;
+          if ( n > ring_size - at )
+               n = ring_size - at;
+          if ( s->out )
+               fwrite ( s->ring + at, 1, n, s->out );
+          tail += n;
+     }
+     if ( s->autoflush && s->out )
+          fflush ( s->out );
+     atomic_store ( &s->tail, tail );
+}
+
+/* writer_main()
+ *
+ * the body of the writer thread.
+ */
+
+static void *writer_main ( void *param )
+{
+     int i;
+
+     (void)param;
+     pthread_mutex_lock ( &writer_lock );
+     while ( 1 )
+     {
+          atomic_store ( &writer_sleeping, 1 );
+          while ( !ring_pending() && !writer_quit )
+               pthread_cond_wait ( &work, &writer_lock );
+          atomic_store ( &writer_sleeping, 0 );
+          if ( writer_quit && !ring_pending() )
+               break;
+          pthread_mutex_unlock ( &writer_lock );
+
+          pthread_mutex_lock ( &io_lock );
+          for ( i = 0; i < output_stream_count; ++i )
+               if ( streams[i].ring )
+                    drain_ring ( streams+i );
+          if ( atomic_exchange ( &flush_wanted, 0 ) )
+               for ( i = 0; i < output_stream_count; ++i )
+                    if ( streams[i].out )
+                         fflush ( streams[i].out );
+          pthread_mutex_unlock ( &io_lock );
+
+          pthread_mutex_lock ( &writer_lock );
+          pthread_cond_broadcast ( &drained );
+     }
+     pthread_mutex_unlock ( &writer_lock );
+
+     return NULL;
+}
+
+/* wait_for_ring()
+ *
+ * waits until the writer thread has taken all but room bytes out of a
+ * stream's ring.
+ */
+
+static void wait_for_ring ( output *s, size_t room )
+{
+     pthread_mutex_lock ( &writer_lock );
+     while ( atomic_load ( &s->head ) - atomic_load ( &s->tail ) >
+             ring_size - room )
+     {
+          pthread_cond_signal ( &work );
+          pthread_cond_wait ( &drained, &writer_lock );
+     }
+     pthread_mutex_unlock ( &writer_lock );
+}
+
+/* ring_write(), ring_close()
+ *
+ * the write and close functions of the FILE handed out for a stream.
+ */
+
+static ssize_t ring_write ( void *cookie, const char *data, size_t size )
+{
+     output *s = (output *)cookie;
+     size_t head, at, n, done = 0;
+
+     while ( done < size )
+     {
+          head = atomic_load_explicit ( &s->head, memory_order_relaxed );
+          n = ring_size - ( head - atomic_load ( &s->tail ) );
+          if ( n == 0 )
+          {
+               wait_for_ring ( s, 1 );
+               continue;
+          }
+          if ( n > size - done )
+               n = size - done;
+          at = head % ring_size;
+          if ( n > ring_size - at )
+               n = ring_size - at;
+          memcpy ( s->ring + at, data + done, n );
+          atomic_store ( &s->head, head + n );
+          done += n;
+          wake_writer();
+     }
+
+     return size;
+}
+
+static int ring_close ( void *cookie )
+{
+     output *s = (output *)cookie;
+
+     wait_for_ring ( s, ring_size );
+     pthread_mutex_lock ( &io_lock );
+     fclose ( s->out );
+     s->out = NULL;
+     pthread_mutex_unlock ( &io_lock );
+     return 0;
+}
+
+#endif
+
+/* open_stream_file()
+ *
+ * opens the file for a stream, behind a ring if the writer thread is
+ * running.
+ */
+
+static FILE *open_stream_file ( output *s, char *fn )
+{
+#ifdef POSIX_MT
+     cookie_io_functions_t io = { NULL, ring_write, NULL, ring_close };
+     FILE *f;
+
+     if ( ring_size == 0 )
+          return fopen ( fn, s->mode );
+
+     f = fopen ( fn, s->mode );
+     if ( f == NULL )
+          return NULL;
+     pthread_mutex_lock ( &io_lock );
+     s->out = f;
+     pthread_mutex_unlock ( &io_lock );
+     if ( s->ring == NULL )
+     {
+          pthread_mutex_lock ( &writer_lock );
+          s->ring = (char *)malloc ( ring_size );
+          atomic_init ( &s->head, 0 );
+          atomic_init ( &s->tail, 0 );
+          pthread_mutex_unlock ( &writer_lock );
+     }
+     f = fopencookie ( s, "w", io );
+     setvbuf ( f, NULL, _IONBF, 0 );
+     return f;
+#else
+     return fopen ( fn, s->mode );
+#endif
+}
+
+/* sync_output_streams()
+ *
+ * waits until everything written to the output streams is in the files,
+ * and flushes them.
+ */
+
+void sync_output_streams ( void )
+{
+#ifdef POSIX_MT
+     int i;
+
+     if ( ring_size == 0 )
+     {
+          flush_output_streams();
+          return;
+     }
+
+     for ( i = 0; i < output_stream_count; ++i )
+          if ( streams[i].ring )
+               wait_for_ring ( streams+i, ring_size );
+     pthread_mutex_lock ( &io_lock );
+     for ( i = 0; i < output_stream_count; ++i )
+          if ( streams[i].out )
+               fflush ( streams[i].out );
+     pthread_mutex_unlock ( &io_lock );
+#else
+     flush_output_streams();
+#endif
+}
+
 /* create_output_stream()
  *
  * make a new entry in the outputstream table.
@@ -138,11 +418,24 @@ void open_output_streams ( void )
      
      fn = (char *)MALLOC ( strlen(basename)+50 );
 
+#ifdef POSIX_MT
+     /* start the writer thread, unless output is to be written directly. */
+     ring_size = atol ( get_parameter ( "output.buffer_size" ) ) * 1024;
+     if ( ring_size > 0 )
+     {
+          atomic_init ( &writer_sleeping, 0 );
+          atomic_init ( &flush_wanted, 0 );
+          writer_quit = 0;
+          if ( pthread_create ( &writer_id, NULL, writer_main, NULL ) != 0 )
+               error ( E_FATAL_ERROR, "cannot create output writer thread" );
+     }
+#endif
+
      for ( i = 0; i < output_stream_count; ++i )
      {
           strcpy ( fn, basename );
           strcat ( fn, streams[i].ext );
-          streams[i].f = fopen ( fn, streams[i].mode );
+          streams[i].f = open_stream_file ( streams+i, fn );
           if ( streams[i].f == NULL )
           {
 	       error ( E_ERROR, "can't open output file \"%s\".", fn );
@@ -285,7 +578,7 @@ void output_stream_open ( int streamid )
                          
                          strcpy ( fn, global_basename );
                          strcat ( fn, streams[i].ext );
-                         streams[i].f = fopen ( fn, streams[i].mode );
+                         streams[i].f = open_stream_file ( streams+i, fn );
                          if ( streams[i].f == NULL )
                          {
                               /* an error. */
@@ -310,7 +603,18 @@ void output_stream_flush ( int streamid )
           if ( streamid == streams[i].id )
                if ( streams[i].reset )
                     if ( streams[i].valid )
+                    {
                          fflush ( streams[i].f );
+#ifdef POSIX_MT
+                         if ( streams[i].ring )
+                         {
+                              wait_for_ring ( streams+i, ring_size );
+                              pthread_mutex_lock ( &io_lock );
+                              fflush ( streams[i].out );
+                              pthread_mutex_unlock ( &io_lock );
+                         }
+#endif
+                    }
 }
 
 /* close_output_streams()
@@ -331,6 +635,25 @@ void close_output_streams ( void )
           }
      }
 
+#ifdef POSIX_MT
+     if ( ring_size > 0 )
+     {
+          pthread_mutex_lock ( &writer_lock );
+          writer_quit = 1;
+          pthread_cond_signal ( &work );
+          pthread_mutex_unlock ( &writer_lock );
+          pthread_join ( writer_id, NULL );
+
+          for ( i = 0; i < output_stream_count; ++i )
+               if ( streams[i].ring )
+               {
+                    free ( streams[i].ring );
+                    streams[i].ring = NULL;
+               }
+          ring_size = 0;
+     }
+#endif
+
      for ( i = SYSOUTPUTSTREAMS; i < MAXOUTPUTSTREAMS; ++i )
      {
           free ( streams[i].ext );
@@ -342,12 +665,23 @@ void close_output_streams ( void )
 
 /* flush_output_streams()
  *
- * flushes all the output streams.
+ * flushes all the output streams.  with the writer thread running this
+ * only asks it to flush them once it has caught up, and does not wait.
  */
 
 void flush_output_streams ( void )
 {
      int i;
+
+#ifdef POSIX_MT
+     if ( ring_size > 0 )
+     {
+          atomic_store ( &flush_wanted, 1 );
+          wake_writer();
+          return;
+     }
+#endif
+
      for ( i = 0; i < output_stream_count; ++i )
           if ( streams[i].valid )
                fflush ( streams[i].f );
@@ -374,6 +708,7 @@ void error ( int severity, char *format, ... )
 
      if ( severity == E_FATAL_ERROR )
      {
+          sync_output_streams();
           fprintf ( stderr, "exiting due to fatal error.\n" );
           exit(1);
      }
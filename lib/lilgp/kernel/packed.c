@@ -0,0 +1,280 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+
+/* packed trees.  a tree in lnodes takes a pointer for every node and a
+ * second lnode for the value of every ERC.  pack_tree() turns a tree into
+ * a single block holding a 16-bit opcode per node, which is the node's
+ * index in its function set, followed by a pool of the tree's ERC values
+ * in prefix order.  a packed tree is a fraction of the size and can be
+ * evaluated straight from the block.
+ *
+ * because the values are kept apart from the opcodes, the prefix order
+ * can be walked backwards:  a terminal pushes its value and a function
+ * pops its arguments, first argument on top, and pushes its result.  the
+ * deepest the stack gets is worked out when the tree is packed.
+ * unpack_tree() turns a packed tree back into lnodes for pretty printing,
+ * checkpoints or breeding.  only trees whose nodes are all FUNC_DATA,
+ * TERM_NORM or TERM_ERC can be packed.  like a compiled tree, a packed
+ * tree carries the scratch columns for evaluate_packed_batch(), so it
+ * must only be run by one thread at a time.
+ */
+
+struct _packed_tree
+{
+     int whichtree;
+     int nodes;                /* opcodes */
+     int consts;               /* ERC values in the pool */
+     int depth;                /* deepest the evaluation stack gets */
+     DATATYPE *pool;
+     unsigned short *op;
+
+     DATATYPE *column;         /* stack for evaluate_packed_batch() */
+     DATATYPE **col;           /* the column at each stack position */
+     int stride;               /* doubles per column */
+};
+
+/* stack depth up to which evaluate_packed() needs no MALLOC. */
+#define PACKED_LOCAL_STACK 64
+
+/* pack_tree()
+ *
+ * packs a tree.  returns NULL if it holds a node type that cannot be
+ * packed or its function set is too big for 16-bit opcodes.
+ */
+
+packed_tree *pack_tree ( lnode *tree, int whichtree )
+{
+     packed_tree *p;
+     function *f;
+     lnode *l;
+     int nodes = 0, consts = 0, open = 1, sp = 0, i, k;
+
+     if ( fset[tree_map[whichtree].fset].size > 65536 )
+          return NULL;
+
+     /* count the nodes and constants, and check every node can be packed. */
+     for ( l = tree; open > 0; ++l )
+     {
+          f = l->f;
+          if ( f->type != FUNC_DATA && f->type != TERM_NORM &&
+               f->type != TERM_ERC )
+               return NULL;
+          ++nodes;
+          if ( f->type == TERM_ERC )
+          {
+               ++consts;
+               ++l;
+          }
+          open += f->arity - 1;
+     }
+
+     p = (packed_tree *)MALLOC ( sizeof ( packed_tree ) +
+                                 consts * sizeof ( DATATYPE ) +
+                                 nodes * sizeof ( unsigned short ) );
+     p->whichtree = whichtree;
+     p->nodes = nodes;
+     p->consts = consts;
+     p->depth = 0;
+     p->pool = (DATATYPE *)( p + 1 );
+     p->op = (unsigned short *)( p->pool + consts );
+     p->column = NULL;
+     p->col = NULL;
+     p->stride = 0;
+
+     for ( l = tree, i = 0, k = 0; i < nodes; ++i )
+     {
+          f = (l++)->f;
+          p->op[i] = f->index;
+          if ( f->type == TERM_ERC )
+               p->pool[k++] = (l++)->d;
+     }
+
+     for ( i = nodes-1; i >= 0; --i )
+     {
+          f = fset[tree_map[whichtree].fset].cset + p->op[i];
+          sp += f->arity ? 1 - f->arity : 1;
+          if ( sp > p->depth )
+               p->depth = sp;
+     }
+
+     return p;
+}
+
+/* unpack_tree()
+ *
+ * rebuilds a packed tree in lnodes.
+ */
+
+void unpack_tree ( packed_tree *p, tree *t )
+{
+     function *cset = fset[tree_map[p->whichtree].fset].cset;
+     function *f;
+     lnode *l;
+     int i, k = 0;
+
+     allocate_tree ( t, p->nodes + p->consts );
+     t->size = p->nodes + p->consts;
+
+     for ( l = t->data, i = 0; i < p->nodes; ++i )
+     {
+          f = cset + p->op[i];
+          (l++)->f = f;
+          if ( f->type == TERM_ERC )
+               (l++)->d = p->pool[k++];
+     }
+     measure_tree ( t );
+}
+
+/* free_packed_tree()
+ *
+ * frees a packed tree.
+ */
+
+void free_packed_tree ( packed_tree *p )
+{
+     if ( p == NULL )
+          return;
+     if ( p->column )
+          FREE ( p->column );
+     if ( p->col )
+          FREE ( p->col );
+     FREE ( p );
+}
+
+/* packed_tree_bytes()
+ *
+ * returns the memory taken by a packed tree.
+ */
+
+int packed_tree_bytes ( packed_tree *p )
+{
+     return sizeof ( packed_tree ) + p->consts * sizeof ( DATATYPE ) +
+          p->nodes * sizeof ( unsigned short );
+}
+
+/* evaluate_packed()
+ *
+ * evaluates a packed tree for the current fitness case, calling the code
+ * of each node with the same arguments evaluate_tree() would.
+ */
+
+DATATYPE evaluate_packed ( packed_tree *p )
+{
+     function *cset = fset[tree_map[p->whichtree].fset].cset;
+     DATATYPE local[PACKED_LOCAL_STACK];
+     DATATYPE *stack = local;
+     DATATYPE *k = p->pool + p->consts;
+     farg arg[MAXARGS];
+     function *f;
+     DATATYPE v = 0.0;
+     int i, j, sp = 0;
+
+     if ( p->depth > PACKED_LOCAL_STACK )
+          stack = (DATATYPE *)MALLOC ( p->depth * sizeof ( DATATYPE ) );
+
+     for ( i = p->nodes-1; i >= 0; --i )
+     {
+          f = cset + p->op[i];
+          if ( f->arity == 0 )
+               v = f->type == TERM_ERC ? *--k : (f->code)(p->whichtree, NULL);
+          else
+          {
+               for ( j = 0; j < f->arity; ++j )
+                    arg[j].d = stack[sp-1-j];
+               sp -= f->arity;
+               v = (f->code)(p->whichtree, arg);
+          }
+          stack[sp++] = v;
+     }
+
+     /* the root is computed last. */
+     if ( stack != local )
+          FREE ( stack );
+     return v;
+}
+
+/* evaluate_packed_batch()
+ *
+ * evaluates a packed tree over a block of fitness cases, calling the
+ * vcode of each node with whole columns just as evaluate_tree_batch()
+ * would.  the results are left in out[0..b->count-1].
+ */
+
+void evaluate_packed_batch ( packed_tree *p, batchinfo *b, DATATYPE *out )
+{
+     function *cset = fset[tree_map[p->whichtree].fset].cset;
+     DATATYPE *k = p->pool + p->consts;
+     DATATYPE **col, *arg[MAXARGS], *c;
+     function *f;
+     int i, j, sp = 0;
+
+     if ( b->count > p->stride )
+     {
+          if ( p->column )
+               FREE ( p->column );
+          else
+               p->col = (DATATYPE **)MALLOC ( p->depth * sizeof ( DATATYPE * ) );
+          p->stride = b->count;
+          p->column = (DATATYPE *)MALLOC ( p->depth * p->stride *
+                                           sizeof ( DATATYPE ) );
+     }
+
+     /* evaluation shuffles the column pointers, so deal them out afresh. */
+     col = p->col;
+     for ( i = 0; i < p->depth; ++i )
+          col[i] = p->column + i * p->stride;
+
+     for ( i = p->nodes-1; i >= 0; --i )
+     {
+          f = cset + p->op[i];
+          if ( f->arity == 0 )
+          {
+               c = col[sp++];
+               if ( f->type == TERM_ERC )
+                    for ( --k, j = 0; j < b->count; ++j )
+                         c[j] = *k;
+               else
+                    (f->vcode)(p->whichtree, b, c, NULL);
+          }
+          else
+          {
+	       /* the result overwrites the first argument, as in
+		  evaluate_tree_batch_recurse(), and then takes the place
+		  of the last. */
+               for ( j = 0; j < f->arity; ++j )
+                    arg[j] = col[sp-1-j];
+               (f->vcode)(p->whichtree, b, arg[0], arg);
+               sp -= f->arity;
+               col[sp+f->arity-1] = col[sp];
+               col[sp++] = arg[0];
+          }
+     }
+
+     memcpy ( out, col[0], b->count * sizeof ( DATATYPE ) );
+}
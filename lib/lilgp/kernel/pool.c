@@ -0,0 +1,214 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+
+#ifdef POSIX_MT
+
+#include <pthread.h>
+
+/* the worker pool.  a fixed set of threads is started once by
+ * initialize_threading() and lives until free_threading().  work is handed
+ * out as "jobs":  run_worker_pool() calls the job function once on every
+ * worker, waits for all of them to return, and then returns itself.  the
+ * evaluation and breeding phases all dispatch through here, so
+ * no threads are created or joined once the run has started.  the time
+ * each worker spends running jobs is added up, for the timing stream.
+ */
+
+typedef struct
+{
+     pthread_t *ids;
+     globaldata *g;            /* each worker's own copy of 'g' */
+     event *busy;              /* time each worker has spent in jobs */
+     int count;
+
+     pthread_mutex_t lock;
+     pthread_cond_t start;     /* signalled when a new job is posted */
+     pthread_cond_t done;      /* signalled when the last worker finishes */
+
+     void (*job)( int, void * );
+     void *arg;
+     int sequence;             /* bumped every time a job is posted */
+     int pending;              /* workers still running the current job */
+     int quit;
+} worker_pool;
+
+static worker_pool pool;
+
+/* worker_main()
+ *
+ * the body of every pool thread.  sleeps until a job is posted, runs it,
+ * and reports back.
+ */
+
+static void *worker_main ( void *param )
+{
+     int index = (int)(long)param;
+     int seen = 0;
+     void (*job)( int, void * );
+     void *arg;
+     event start, end;
+
+     set_globaldata ( pool.g + index );
+     bind_random_stream ( index );
+     bind_thread_genspace ( index );
+     bind_arena_lane ( index+1 );
+
+     pthread_mutex_lock ( &pool.lock );
+     while ( 1 )
+     {
+          while ( pool.sequence == seen && !pool.quit )
+               pthread_cond_wait ( &pool.start, &pool.lock );
+          if ( pool.quit )
+               break;
+          seen = pool.sequence;
+          job = pool.job;
+          arg = pool.arg;
+          pthread_mutex_unlock ( &pool.lock );
+
+          event_mark ( &start );
+          job ( index, arg );
+          event_mark ( &end );
+
+          pthread_mutex_lock ( &pool.lock );
+          event_accumdiff ( pool.busy + index, &start, &end );
+          if ( --pool.pending == 0 )
+               pthread_cond_signal ( &pool.done );
+     }
+     pthread_mutex_unlock ( &pool.lock );
+
+     return NULL;
+}
+
+/* start_worker_pool()
+ *
+ * starts count worker threads with the given attributes.
+ */
+
+void start_worker_pool ( int count, pthread_attr_t *attr )
+{
+     int i;
+
+     pool.ids = (pthread_t *)MALLOC ( count * sizeof ( pthread_t ) );
+     pool.g = (globaldata *)MALLOC ( count * sizeof ( globaldata ) );
+     memset ( pool.g, 0, count * sizeof ( globaldata ) );
+     pool.busy = (event *)MALLOC ( count * sizeof ( event ) );
+     for ( i = 0; i < count; ++i )
+          event_zero ( pool.busy + i );
+     pool.count = count;
+     pool.job = NULL;
+     pool.arg = NULL;
+     pool.sequence = 0;
+     pool.pending = 0;
+     pool.quit = 0;
+
+     pthread_mutex_init ( &pool.lock, NULL );
+     pthread_cond_init ( &pool.start, NULL );
+     pthread_cond_init ( &pool.done, NULL );
+
+     for ( i = 0; i < count; ++i )
+          if ( pthread_create ( pool.ids + i, attr, worker_main,
+                               (void *)(long)i ) != 0 )
+               error ( E_FATAL_ERROR, "cannot create thread" );
+}
+
+/* stop_worker_pool()
+ *
+ * tells the workers to exit, waits for them, and frees the pool.
+ */
+
+void stop_worker_pool ( void )
+{
+     int i;
+
+     pthread_mutex_lock ( &pool.lock );
+     pool.quit = 1;
+     pthread_cond_broadcast ( &pool.start );
+     pthread_mutex_unlock ( &pool.lock );
+
+     for ( i = 0; i < pool.count; ++i )
+          pthread_join ( pool.ids[i], NULL );
+
+     pthread_cond_destroy ( &pool.done );
+     pthread_cond_destroy ( &pool.start );
+     pthread_mutex_destroy ( &pool.lock );
+
+     FREE ( pool.ids );
+     FREE ( pool.g );
+     FREE ( pool.busy );
+     pool.count = 0;
+}
+
+/* run_worker_pool()
+ *
+ * calls job(i, arg) on worker i, for every worker, and returns once they
+ * have all finished.  must only be called from the main thread.
+ */
+
+void run_worker_pool ( void (*job)( int, void * ), void *arg )
+{
+     pthread_mutex_lock ( &pool.lock );
+     pool.job = job;
+     pool.arg = arg;
+     pool.pending = pool.count;
+     ++pool.sequence;
+     pthread_cond_broadcast ( &pool.start );
+     while ( pool.pending )
+          pthread_cond_wait ( &pool.done, &pool.lock );
+     pthread_mutex_unlock ( &pool.lock );
+}
+
+/* worker_pool_size()
+ *
+ * returns the number of workers.
+ */
+
+int worker_pool_size ( void )
+{
+     return pool.count;
+}
+
+/* take_worker_busy()
+ *
+ * copies how long each worker has spent running jobs since the last call
+ * into busy[0..count-1], and starts the counts again from zero.  must only
+ * be called from the main thread, between jobs.
+ */
+
+void take_worker_busy ( event *busy )
+{
+     int i;
+
+     for ( i = 0; i < pool.count; ++i )
+     {
+          busy[i] = pool.busy[i];
+          event_zero ( pool.busy + i );
+     }
+}
+
+#endif
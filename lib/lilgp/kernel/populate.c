@@ -29,12 +29,12 @@
 
 
 /* Read in an individual from a file, skipping any text in between */
-void mod_read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
+void mod_read_tree_recurse ( int space, DATATYPE *eind, FILE *fil, int tree,
 			     char *string, int skip )
 {
   function *f;
   int i, j;
-  ephem_const *ep;
+  DATATYPE ep;
 
   if( skip )
     {
@@ -79,8 +79,8 @@ void mod_read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
 #endif
 
   /* look up the function name in this tree's function set.  if the
-     function is an ERC terminal (the name is of the form "name:ERCindex"),
-     then place the ERC address in ep. */
+     function is an ERC terminal (the name is of the form "name:#value"),
+     then place the ERC value in ep. */
   f = get_function_by_name ( tree, string, &ep, eind );
   /* add an lnode to the tree. */
   gensp_next(space)->f = f;
@@ -92,7 +92,7 @@ void mod_read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
     case EVAL_TERM:
       break;
     case TERM_ERC:
-      /* record the ERC address as the next lnode in the array. */
+      /* record the ERC value as the next lnode in the array. */
       gensp_next(space)->d = ep;
       break;
     case FUNC_DATA:
@@ -148,6 +148,9 @@ void generate_random_population ( population *p, int *mindepth,
   ignore_limits = (get_parameter("init.ignore_limits")!=NULL);
 
   temp = (tree *)MALLOC ( tree_count * sizeof ( tree ) );
+
+  /* build the trees straight into the population's arena. */
+  bind_tree_arena ( p->arena );
      
   k = 0;
   attempts = attempts_generation;
@@ -168,7 +171,7 @@ void generate_random_population ( population *p, int *mindepth,
 	  ++totalattempts;
 
 	  /* pick a depth on the depth ramp. */
-	  depth = mindepth[j] + random_int ( &globrand, maxdepth[j] - mindepth[j] + 1 );
+	  depth = mindepth[j] + random_int ( get_randomgen(), maxdepth[j] - mindepth[j] + 1 );
 
 	  /* clear a generation space. */
 	  gensp_reset ( 0 );
@@ -185,7 +188,7 @@ void generate_random_population ( population *p, int *mindepth,
 					  tree_map[j].return_type);
 	      break;
 	    case GENERATE_HALF_AND_HALF:
-	      if ( random_double(&globrand) < 0.5  )
+	      if ( random_double(get_randomgen()) < 0.5  )
 		generate_random_full_tree ( 0, depth, fset+tree_map[j].fset,
 					    tree_map[j].return_type);
 	      else
@@ -288,10 +291,6 @@ void generate_random_population ( population *p, int *mindepth,
 
       /* copy the tree array. */
       memcpy ( p->ind[k].tr, temp, tree_count * sizeof ( tree ) );
-
-      /* reference ERCs. */
-      for ( j = 0; j < tree_count; ++j )
-	reference_ephem_constants ( p->ind[k].tr[j].data, 1 );
           
 #ifdef DUMP_POPULATION
       printf ( "individual %5d:\n", k );
@@ -306,6 +305,7 @@ void generate_random_population ( population *p, int *mindepth,
           
     }
 
+  bind_tree_arena ( NULL );
   FREE ( temp );
      
   oprintf ( OUT_SYS, 10,
@@ -326,6 +326,9 @@ population *allocate_population ( int size )
 
   p->size = size;
   p->next = 0;
+  /* the trees go in an arena of their own, released with the population. */
+  p->arena = get_tree_arena();
+  p->summary = NULL;
   /* allocate the array of individuals. */
   p->ind = (individual *)MALLOC ( size * sizeof ( individual ) );
 
@@ -336,6 +339,7 @@ population *allocate_population ( int size )
       p->ind[i].tr = (tree *)MALLOC ( tree_count * sizeof ( tree ) );
       p->ind[i].evald = EVAL_CACHE_INVALID;
       p->ind[i].flags = FLAG_NONE;
+      clear_lineage ( p->ind+i );
     }
 
   return p;
@@ -366,13 +370,13 @@ void free_population ( population *p )
   for ( i = 0; i < p->size; ++i )
     {
       for ( j = 0; j < tree_count; ++j )
-	{
-	  /* dereference ERCs. */
-	  reference_ephem_constants ( p->ind[i].tr[j].data, -1 );
-	  free_tree ( &(p->ind[i].tr[j]) );
-	}
+	free_tree ( &(p->ind[i].tr[j]) );
       FREE ( p->ind[i].tr );
+      release_lineage ( p->ind+i );
     }
+  free_pop_summary ( p->summary );
+  /* this releases every tree that was allocated in the arena at once. */
+  retire_tree_arena ( p->arena );
   FREE ( p->ind );
   FREE ( p );
 }
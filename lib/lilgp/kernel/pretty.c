@@ -113,7 +113,7 @@ void pretty_print_tree_recurse(lnode** l, int** is, FILE* fil)
         if (f->ephem_gen)
         {
             /* show value of ERCs. */
-            fprintf(fil, " %s", (f->ephem_str)((**l).d->d));
+            fprintf(fil, " %s", (f->ephem_str)((**l).d));
             ++*l;
         } else
             /* show name of other terminals. */
@@ -172,7 +172,7 @@ void pretty_print_tree_recurse_equ(lnode** l, int** is, FILE* fil)
         if (f->ephem_gen)
         {
             /* show value of ERCs. */
-            fprintf(fil, "%s", (f->ephem_str)((**l).d->d));
+            fprintf(fil, "%s", (f->ephem_str)((**l).d));
             ++*l;
         } else
             /* show name of other terminals. */
@@ -30,7 +30,12 @@
 
 
 extern randomgen globrand;
-extern genspace gensp[GENSPACE_COUNT];
+#ifdef __cplusplus
+extern thread_local genspace *gensp;
+#else
+extern _Thread_local genspace *gensp;
+#endif
+extern int numthreads;
 extern function_set *fset;
 extern int fset_count;
 extern treeinfo *tree_map;
@@ -46,6 +51,17 @@ void free_topology ( multipop *mpop );
 void rebuild_exchange_topology ( multipop *mpop );
 
 
+/*** arena.c ***/
+
+void initialize_tree_arenas ( int workers );
+void free_tree_arenas ( void );
+tree_arena *get_tree_arena ( void );
+void retire_tree_arena ( tree_arena *a );
+void bind_tree_arena ( tree_arena *a );
+void bind_arena_lane ( int lane );
+lnode *arena_alloc ( int count );
+
+
 /*** change.c ***/
 
 population *change_population ( population *pop, breedphase * );
@@ -62,39 +78,102 @@ char *get_breed_parameter ( char *prefix, char *format, ... );
 
 void read_checkpoint ( char *filename, int *gen, multipop **mpop );
 void write_checkpoint ( int gen, multipop *mpop, char *filename );
-population *read_population ( ephem_const **eind, FILE *f );
-void read_individual ( individual *ind, ephem_const **eind, FILE *f,
+population *read_population ( DATATYPE *eind, FILE *f );
+void read_individual ( individual *ind, DATATYPE *eind, FILE *f,
 		      char *buffer );
-void write_individual ( individual *ind, ephem_index *eind, FILE *f );
-void read_tree_recurse ( int space, ephem_const **eind, FILE *fil, int tree,
+void write_individual ( individual *ind, FILE *f );
+void read_tree_recurse ( int space, DATATYPE *eind, FILE *fil, int tree,
 			char *string );
-function * get_function_by_name ( int tree, char *string, ephem_const **ep,
-				 ephem_const **eind );
-void write_population ( population *pop, ephem_index *eind, FILE *f );
-void write_tree_recurse ( lnode **l, ephem_index *eind, FILE *fil );
+function * get_function_by_name ( int tree, char *string, DATATYPE *ep,
+				 DATATYPE *eind );
+void write_population ( population *pop, FILE *f );
+void write_tree_recurse ( lnode **l, FILE *fil );
 void write_hex_block ( void *, int, FILE * );
 void read_hex_block ( void *, int, FILE * );
+void scan_hex_block ( void *, int, char * );
 
 
 /*** ephem.c ***/
 
 void initialize_ephem_const ( void );
-void free_ephem_const ( void );
-void enlarge_ephem_space ( void );
-void ephem_const_gc ( void );
-ephem_const *new_ephemeral_const ( function *f );
-int ephem_index_comp ( const void *a, const void *b );
-ephem_index *write_ephem_list ( FILE *f );
-int lookup_ephem ( ephem_index *ind, ephem_const *e );
-ephem_const **read_ephem_list ( FILE *f );
-void get_ephem_stats ( int *used, int *free, int *blocks, int *alloc );
+DATATYPE new_ephemeral_const ( function *f );
+void write_ephem_list ( FILE *f );
+DATATYPE *read_ephem_list ( FILE *f );
+void get_ephem_stats ( int *used );
 
 
 /*** eval.c ***/
 
 void set_current_individual ( individual * );
+void initialize_evaluation ( void );
+void free_evaluation ( void );
 DATATYPE evaluate_tree ( lnode *, int );
 DATATYPE evaluate_tree_recurse ( lnode **, int );
+DATATYPE evaluate_tree_stack ( lnode *, int );
+int evaluate_batch_capable ( int fs );
+void evaluate_tree_batch ( lnode *, int, batchinfo *, DATATYPE * );
+void evaluate_tree_batch_recurse ( lnode **, int, batchinfo *, DATATYPE *,
+                                  DATATYPE *, int );
+
+
+/*** compile.c ***/
+
+compiled_tree *compile_tree ( lnode *, int );
+void free_compiled_tree ( compiled_tree * );
+DATATYPE evaluate_compiled ( compiled_tree * );
+void evaluate_compiled_batch ( compiled_tree *, batchinfo *, DATATYPE * );
+
+
+/*** packed.c ***/
+
+packed_tree *pack_tree ( lnode *, int );
+void unpack_tree ( packed_tree *, tree * );
+void free_packed_tree ( packed_tree * );
+int packed_tree_bytes ( packed_tree * );
+DATATYPE evaluate_packed ( packed_tree * );
+void evaluate_packed_batch ( packed_tree *, batchinfo *, DATATYPE * );
+
+
+/*** offsets.c ***/
+
+tree_offsets *get_tree_offsets ( tree * );
+void free_tree_offsets ( tree * );
+lnode *tree_point ( tree *, int );
+lnode *tree_point_internal ( tree *, int );
+lnode *tree_point_external ( tree *, int );
+int point_nodes ( tree *, lnode * );
+int point_depth ( tree *, lnode * );
+int point_size ( tree *, lnode * );
+int point_level ( tree *, lnode * );
+
+
+/*** memo.c ***/
+
+void initialize_subtree_memo ( void );
+void free_subtree_memo ( void );
+void clear_subtree_memo ( void );
+int subtree_memo_enabled ( void );
+void get_subtree_memo_stats ( long *lookups, long *found );
+void memo_hash_tree ( lnode *, unsigned long long *, int *, char * );
+int memo_lookup ( unsigned long long, int, int, batchinfo *, DATATYPE * );
+void memo_store ( unsigned long long, int, int, batchinfo *, DATATYPE * );
+
+
+/*** spine.c ***/
+
+void initialize_spines ( void );
+int spine_depth ( void );
+void get_spine_stats ( long *reused, long *computed );
+spine *new_spine ( lnode *, int, void *, unsigned long long *, int * );
+spine *retain_spine ( spine * );
+void release_spine ( spine * );
+void clear_lineage ( individual * );
+void release_lineage ( individual * );
+void splice_lineage ( individual *, int, int, int );
+DATATYPE *spine_column ( spine *, int, int, unsigned long long, int,
+                         batchinfo * );
+void spine_save ( spine *, int, batchinfo *, DATATYPE * );
+void spine_inherit ( spine *, spine *, int, int, int, int, batchinfo * );
 
 
 /*** fsetupdate.c ***/
@@ -102,24 +181,39 @@ DATATYPE evaluate_tree_recurse ( lnode **, int );
 void fset_update ( function_set *app_fset );
 
 
+/*** fcache.c ***/
+
+void initialize_fitness_cache ( void );
+void free_fitness_cache ( void );
+void get_fitness_cache_stats ( long *lookups, long *found );
+#ifndef COEVOLUTION
+void evaluate_individual ( individual * );
+#endif
+
+
 /*** gp.c ***/
 
 void run_gp ( multipop *mpop, int startgen,
              event *t_eval, event *t_breed, int startfromcheckpoint );
+double get_evaluation_bound ( void );
+double fitness_quantile ( population *, double );
 int generation_information ( int gen, multipop *mpop, int stt_interval,
                             int bestn );
 void evaluate_pop ( population *pop );
 int accumulate_pop_stats ( popstats *total, popstats *n );
 void calculate_pop_stats ( popstats *s, population *pop, int gen, int subpop );
+void free_pop_summary ( pop_summary *sum );
 void saved_individual_gc ( void );
-saved_ind ** write_saved_individuals ( ephem_index *eind, FILE *f );
-void write_stats_checkpoint ( multipop *mpop, ephem_index *eind, FILE *f );
-saved_ind ** read_saved_individuals ( ephem_const **eind, FILE *f );
-void read_stats_checkpoint ( multipop *mpop, ephem_const **eind, FILE *f );
+saved_ind ** write_saved_individuals ( FILE *f );
+void write_stats_checkpoint ( multipop *mpop, FILE *f );
+saved_ind ** read_saved_individuals ( DATATYPE *eind, FILE *f );
+void read_stats_checkpoint ( multipop *mpop, DATATYPE *eind, FILE *f );
 globaldata *get_globaldata( void );
 #if defined(POSIX_MT) || defined(SOLARIS_MT)
+void set_globaldata( globaldata * );
 void initialize_threading( void );
-void *evaluate_pop_chunk( void * );
+void free_threading( void );
+void evaluate_pop_chunk( int, void * );
 #endif
 
 
@@ -148,11 +242,14 @@ void initial_message ( void );
 #define FREE free
 #define REALLOC realloc
 #endif
+#ifdef TRACK_MEMORY
 void *track_malloc ( unsigned long );
 void track_free ( void * );
 void *track_realloc ( void *, int );
+void sample_memory_stats ( void );
 void get_memory_stats ( int *total, int *free, int *max,
                        int *mallocc, int *reallocc, int *freec );
+#endif
 
 
 /*** output.c ***/
@@ -172,6 +269,7 @@ void error ( int severity, char *format, ... );
 void set_detail_level ( int );
 int test_detail_level ( int );
 void flush_output_streams ( void );
+void sync_output_streams ( void );
 
 
 /*** params.c ***/
@@ -213,6 +311,17 @@ int postscript_recurse ( lnode **, FILE *, int, int, int );
 void make_postscript_tree ( lnode *, char *, int );
 
 
+/*** pool.c ***/
+
+#ifdef POSIX_MT
+void start_worker_pool ( int count, pthread_attr_t *attr );
+void stop_worker_pool ( void );
+void run_worker_pool ( void (*job)( int, void * ), void *arg );
+int worker_pool_size ( void );
+void take_worker_busy ( event *busy );
+#endif
+
+
 /*** random.c ***/
 
 void random_seed ( randomgen *, int );
@@ -221,6 +330,13 @@ int random_int ( randomgen *, int );
 double random_double ( randomgen * );
 void *random_get_state ( randomgen *, int * );
 void random_set_state ( randomgen *, void * );
+randomgen *get_randomgen ( void );
+void random_alloc_streams ( int );
+void initialize_random_streams ( int );
+void free_random_streams ( void );
+void bind_random_stream ( int );
+int random_stream_count ( void );
+randomgen *random_stream ( int );
 
 
 /*** select.c ***/
@@ -279,6 +395,8 @@ int generate_random_full_tree ( int space, int depth, function_set *, int return
 int generate_random_grow_tree ( int space, int depth, function_set *, int return_type );
 int tree_depth ( lnode * );
 int tree_depth_recurse ( lnode ** );
+void measure_tree ( tree * );
+int measure_tree_recurse ( lnode **, tree * );
 int tree_depth_to_subtree ( lnode *, lnode * );
 int tree_depth_to_subtree_recurse ( lnode **, lnode *, int );
 void print_tree ( lnode *, FILE * );
@@ -292,16 +410,20 @@ lnode *get_subtree_internal_recurse ( lnode **, int * );
 lnode *get_subtree_external ( lnode *, int );
 lnode *get_subtree_external_recurse ( lnode **, int * );
 void copy_tree ( tree *to, tree *from );
+void allocate_tree ( tree *, int );
 void free_tree ( tree * );
 int tree_size ( lnode * );
 int tree_size_recurse ( lnode ** );
+unsigned long long tree_hash ( lnode *, unsigned long long );
+unsigned long long tree_hash_recurse ( lnode **, unsigned long long );
 void copy_tree_replace_many ( int space, lnode *parent, lnode **replace,
                             lnode **with, int count, int *repcount );
 void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
                                     lnode **lw, int count, int *repcount );
+int fset_has_skips ( function_set * );
+void splice_tree ( int space, tree *parent, int whichtree, lnode *cut,
+                   lnode *with, int withsize );
 void skip_over_subtree ( lnode ** );
-void reference_ephem_constants ( lnode *, int );
-void reference_ephem_constants_recurse ( lnode **, int );
 
 
 /*** pretty.c ***/
@@ -317,8 +439,12 @@ void pretty_print_tree_equ ( lnode *data, FILE *fil );
 
 void initialize_genspace ( void );
 void free_genspace ( void );
+void initialize_thread_genspace ( int count );
+void free_thread_genspace ( void );
+void bind_thread_genspace ( int index );
 lnode * gensp_next ( int space );
 int gensp_next_int ( int space );
+lnode * gensp_next_block ( int space, int n );
 void gensp_dup_tree ( int space, tree *t );
 void gensp_reset ( int space );
 void gensp_print ( int space, int i, int j, FILE *out );
@@ -332,6 +458,8 @@ void pretty_print_individual_equ ( individual *ind, FILE *f );
 int individual_size ( individual *ind );
 int individual_depth ( individual *ind );
 void duplicate_individual ( individual *to, individual *from );
+void duplicate_individual_except ( individual *to, individual *from, int skip );
+unsigned long long individual_hash ( individual *ind );
 
 
 /*** crossover.c ***/
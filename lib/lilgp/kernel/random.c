@@ -27,7 +27,6 @@
 
 
 #include <lilgp.h>
-#include <pthread.h>
 
 /*
  * adapted from the RAN3 routine (in Fortran - ugh) in "Numerical Recipes:
@@ -46,8 +45,6 @@ void random_seed ( randomgen *randstr, int seed )
      int i, i1, k;
      double mj, mk, ms;
      
-     pthread_mutex_init(&randstr->rmut, NULL);
-
      randstr->mbig = 10000000.0;
      randstr->mseed = 1618033.0;
      randstr->mz = 0.0;
@@ -84,12 +81,14 @@ void random_seed ( randomgen *randstr, int seed )
 
 /* random_destroy()
  *
- * destroys the mutex with the random structure
+ * releases anything held by the random structure.  a generator is only
+ * ever drawn from by the thread that owns it, so there is no lock to tear
+ * down any more; this is kept so callers need not care.
  */
 
 void random_destroy ( randomgen *randstr )
 {
-     pthread_mutex_destroy(&randstr->rmut);
+     (void) randstr;
 }
 
      
@@ -113,12 +112,7 @@ int random_int ( randomgen *randstr, int max )
 
 double random_double ( randomgen *randstr )
 {
-  /* There's a race condition on this, so we need to mutex it! */
-
      double mj;
-     double res;
-
-     pthread_mutex_lock(&(randstr->rmut));
 
      randstr->inext = (randstr->inext+1)%55;
      randstr->inextp = (randstr->inextp+1)%55;
@@ -128,9 +122,7 @@ double random_double ( randomgen *randstr )
           mj = mj + randstr->mbig;
      randstr->ma[randstr->inext] = mj;
 
-     res=randstr->mbig;
-     pthread_mutex_unlock(&(randstr->rmut));
-     return mj/res;
+     return mj/randstr->mbig;
 }
 
 /* random_get_state()
@@ -198,3 +190,107 @@ void random_set_state ( randomgen *randstr, void *buffer )
      
 }
 
+
+/* per-thread streams.  each worker thread draws from its own generator,
+ * so no draw ever has to lock.  the streams are seeded from globrand,
+ * which makes a run reproducible from random_seed alone, and they are
+ * written to and read from checkpoints alongside globrand.  any thread
+ * that has not been bound to a stream (in particular the main thread)
+ * uses globrand itself.
+ */
+
+static randomgen *streams = NULL;
+static int stream_count = 0;
+static _Thread_local randomgen *thread_stream = NULL;
+
+/* get_randomgen()
+ *
+ * returns the generator the calling thread should draw from.
+ */
+
+randomgen *get_randomgen ( void )
+{
+     return thread_stream ? thread_stream : &globrand;
+}
+
+/* random_alloc_streams()
+ *
+ * makes room for count per-thread streams, throwing away any old ones.
+ * the streams are left unseeded.
+ */
+
+void random_alloc_streams ( int count )
+{
+     free_random_streams();
+     streams = (randomgen *)MALLOC ( count * sizeof ( randomgen ) );
+     stream_count = count;
+}
+
+/* initialize_random_streams()
+ *
+ * sets up count per-thread streams, each seeded by a draw from globrand.
+ * if a checkpoint already restored exactly that many streams they are
+ * kept as they are, so a restarted run carries on where it stopped.
+ */
+
+void initialize_random_streams ( int count )
+{
+     int i;
+
+     if ( streams != NULL && stream_count == count )
+          return;
+
+     random_alloc_streams ( count );
+     for ( i = 0; i < count; ++i )
+          random_seed ( streams+i, random_int ( &globrand, (int)globrand.mbig ) );
+}
+
+/* free_random_streams()
+ *
+ * releases the per-thread streams.
+ */
+
+void free_random_streams ( void )
+{
+     int i;
+
+     if ( streams == NULL )
+          return;
+     for ( i = 0; i < stream_count; ++i )
+          random_destroy ( streams+i );
+     FREE ( streams );
+     streams = NULL;
+     stream_count = 0;
+}
+
+/* bind_random_stream()
+ *
+ * makes stream index the calling thread's generator.
+ */
+
+void bind_random_stream ( int index )
+{
+     if ( index < 0 || index >= stream_count )
+          error ( E_FATAL_ERROR, "no random stream %d.", index );
+     thread_stream = streams+index;
+}
+
+/* random_stream_count()
+ *
+ * returns the number of per-thread streams.
+ */
+
+int random_stream_count ( void )
+{
+     return stream_count;
+}
+
+/* random_stream()
+ *
+ * returns per-thread stream index, for checkpointing.
+ */
+
+randomgen *random_stream ( int index )
+{
+     return streams+index;
+}
@@ -242,7 +242,7 @@ int select_interval ( sel_context *sc )
      interval_data *id = sc->data;
      int low = 0, high = id->count;
      
-     rval = random_double(&globrand) * id->total;
+     rval = random_double(get_randomgen()) * id->total;
 
 #ifdef DEBUG_INTERVAL
      printf ( "random value is %.6f (%.6f)\n", rval, id->total );
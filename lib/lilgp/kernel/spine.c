@@ -0,0 +1,402 @@
+/*  lil-gp Genetic Programming System, version 1.0, 11 July 1995
+ *  Copyright (C) 1995  Michigan State University
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Douglas Zongker       (zongker@isl.cps.msu.edu)
+ *  Dr. Bill Punch        (punch@isl.cps.msu.edu)
+ *
+ *  Computer Science Department
+ *  A-714 Wells Hall
+ *  Michigan State University
+ *  East Lansing, Michigan  48824
+ *  USA
+ *
+ */
+
+#include <lilgp.h>
+#include <stdatomic.h>
+
+/* spines.  when crossover or mutation replaces one subtree of a parent,
+ * only the nodes on the path from the splice point up to the root change
+ * value; every subtree hanging off that path is the same as in the
+ * parent.  so when the batch evaluator runs an individual it saves the
+ * columns of the function nodes in the top "eval.spine_depth" levels of
+ * its tree in a spine, and the individual's offspring inherit it.  when
+ * an offspring is evaluated, the subtrees off the path are copied from
+ * the parent's spine and only the path itself and the new subtree are
+ * computed.
+ *
+ * the splice point only says where to look in the parent's spine; a
+ * column is used only if the subtree's hash and length match the
+ * offspring's, so stale or misplaced columns are never picked up.
+ * spines are reference counted, since a parent's spine is shared by all
+ * its offspring, and the memory they take is capped at "eval.spine_size"
+ * megabytes.  an individual that would go over keeps no spine.
+ */
+
+typedef struct
+{
+     int first;                /* first case of the block */
+     int count;
+     DATATYPE *values;         /* one column of count values per entry */
+     char *filled;             /* which entries have been saved */
+} spine_block;
+
+struct _spine
+{
+     atomic_int refs;
+     void *cases;
+     int whichtree;
+
+     int lnodes;               /* length of the tree */
+     int *entry;               /* entry for each lnode offset, or -1 */
+     int entries;
+     unsigned long long *hash; /* the hash ... */
+     int *span;                /* ... and length of each entry's subtree */
+
+     spine_block *block;
+     int blocks;
+     int maxblocks;
+     int broken;               /* a block could not be allocated */
+     long bytes;
+};
+
+static int max_depth = 0;
+static long limit = 0;
+static atomic_long used;
+static atomic_long reused;
+static atomic_long computed;
+
+/* initialize_spines()
+ *
+ * reads the "eval.spine_size" (megabytes, zero turns spines off) and
+ * "eval.spine_depth" parameters.
+ */
+
+void initialize_spines ( void )
+{
+     long size;
+
+     size = atol ( get_parameter ( "eval.spine_size" ) );
+     if ( size < 0 )
+          error ( E_FATAL_ERROR, "eval.spine_size must be >= 0" );
+     max_depth = atoi ( get_parameter ( "eval.spine_depth" ) );
+     if ( max_depth < 1 )
+          error ( E_FATAL_ERROR, "eval.spine_depth must be >= 1" );
+
+     limit = size * 1024 * 1024;
+     atomic_init ( &used, 0 );
+     atomic_init ( &reused, 0 );
+     atomic_init ( &computed, 0 );
+
+     if ( limit > 0 )
+          oprintf ( OUT_SYS, 30, "    spines of %d levels, up to %ld MB.\n",
+                    max_depth, size );
+}
+
+/* spine_depth()
+ *
+ * returns how many levels below the root spines cover, or 0 if they are
+ * turned off.
+ */
+
+int spine_depth ( void )
+{
+     return limit > 0 ? max_depth : 0;
+}
+
+/* get_spine_stats()
+ *
+ * returns how many columns were copied from a parent's spine and how many
+ * were looked for there but had to be computed.
+ */
+
+void get_spine_stats ( long *r, long *c )
+{
+     *r = atomic_load ( &reused );
+     *c = atomic_load ( &computed );
+}
+
+/* new_spine()
+ *
+ * makes an empty spine for the given tree, with an entry for every
+ * function node from depth 1 to the spine depth.  hash and span are the
+ * per-lnode arrays filled in by memo_hash_tree().  returns NULL if spines
+ * are off or the tree has no such nodes.
+ */
+
+static void spine_mark_recurse ( lnode **l, lnode *base, int depth,
+                                 spine *s )
+{
+     function *f = (**l).f;
+     int p = *l - base;
+     int i;
+
+     ++*l;
+     if ( f->arity == 0 )
+     {
+          if ( f->ephem_gen )
+               ++*l;
+          return;
+     }
+
+     if ( depth > 0 && depth <= max_depth )
+          s->entry[p] = s->entries++;
+     for ( i = 0; i < f->arity; ++i )
+          spine_mark_recurse ( l, base, depth+1, s );
+}
+
+spine *new_spine ( lnode *tree, int whichtree, void *cases,
+                   unsigned long long *hash, int *span )
+{
+     spine *s;
+     lnode *l = tree;
+     int i, n;
+
+     if ( limit == 0 )
+          return NULL;
+
+     s = (spine *)MALLOC ( sizeof ( spine ) );
+     atomic_init ( &s->refs, 1 );
+     s->cases = cases;
+     s->whichtree = whichtree;
+     s->lnodes = span[0];
+     s->entry = (int *)MALLOC ( s->lnodes * sizeof ( int ) );
+     for ( i = 0; i < s->lnodes; ++i )
+          s->entry[i] = -1;
+     s->entries = 0;
+     spine_mark_recurse ( &l, tree, 0, s );
+     if ( s->entries == 0 )
+     {
+	  /* nothing below the root is worth keeping. */
+          FREE ( s->entry );
+          FREE ( s );
+          return NULL;
+     }
+
+     n = s->entries;
+     s->hash = (unsigned long long *)MALLOC ( n * sizeof ( unsigned long long ) );
+     s->span = (int *)MALLOC ( n * sizeof ( int ) );
+     for ( i = 0; i < s->lnodes; ++i )
+          if ( s->entry[i] != -1 )
+          {
+               s->hash[s->entry[i]] = hash[i];
+               s->span[s->entry[i]] = span[i];
+          }
+
+     s->block = NULL;
+     s->blocks = 0;
+     s->maxblocks = 0;
+     s->broken = 0;
+     s->bytes = 0;
+
+     return s;
+}
+
+/* retain_spine(), release_spine()
+ *
+ * take and drop a reference to a spine.  the spine is freed when the last
+ * reference goes.  both accept NULL.
+ */
+
+spine *retain_spine ( spine *s )
+{
+     if ( s )
+          atomic_fetch_add ( &s->refs, 1 );
+     return s;
+}
+
+void release_spine ( spine *s )
+{
+     int i;
+
+     if ( s == NULL || atomic_fetch_sub ( &s->refs, 1 ) != 1 )
+          return;
+
+     for ( i = 0; i < s->blocks; ++i )
+     {
+          FREE ( s->block[i].values );
+          FREE ( s->block[i].filled );
+     }
+     if ( s->block )
+          FREE ( s->block );
+     atomic_fetch_sub ( &used, s->bytes );
+     FREE ( s->hash );
+     FREE ( s->span );
+     FREE ( s->entry );
+     FREE ( s );
+}
+
+/* clear_lineage(), release_lineage()
+ *
+ * start an individual off with no spines, and drop the ones it has.
+ */
+
+void clear_lineage ( individual *ind )
+{
+     ind->ln.own = NULL;
+     ind->ln.from = NULL;
+     ind->ln.edit = -1;
+     ind->ln.shift = 0;
+}
+
+void release_lineage ( individual *ind )
+{
+     release_spine ( ind->ln.own );
+     release_spine ( ind->ln.from );
+     clear_lineage ( ind );
+}
+
+/* splice_lineage()
+ *
+ * called by a breeding operator after it has replaced the subtree of
+ * oldlen lnodes at offset at in a copy of a parent with newlen lnodes.
+ * the parent's spine, picked up by duplicate_individual(), becomes the
+ * one the offspring is evaluated from.
+ */
+
+void splice_lineage ( individual *ind, int at, int oldlen, int newlen )
+{
+     release_spine ( ind->ln.from );
+     ind->ln.from = ind->ln.own;
+     ind->ln.own = NULL;
+     ind->ln.edit = at + newlen;
+     ind->ln.shift = oldlen - newlen;
+}
+
+/* find_block()
+ *
+ * returns a spine's storage for the block of cases b, or NULL.  with
+ * create set, the storage is added if it is not there.
+ */
+
+static spine_block *find_block ( spine *s, batchinfo *b, int create )
+{
+     spine_block *k;
+     long bytes;
+     int i;
+
+     for ( i = 0; i < s->blocks; ++i )
+          if ( s->block[i].first == b->first )
+               return s->block[i].count == b->count ? s->block+i : NULL;
+
+     if ( !create || s->broken )
+          return NULL;
+
+     bytes = s->entries * ( b->count * (long)sizeof ( DATATYPE ) + 1 );
+     if ( atomic_fetch_add ( &used, bytes ) + bytes > limit )
+     {
+          atomic_fetch_sub ( &used, bytes );
+          s->broken = 1;
+          return NULL;
+     }
+     s->bytes += bytes;
+
+     if ( s->blocks == s->maxblocks )
+     {
+          s->maxblocks = s->maxblocks ? s->maxblocks * 2 : 4;
+          if ( s->block )
+               s->block = (spine_block *)REALLOC ( s->block, s->maxblocks *
+                                                   sizeof ( spine_block ) );
+          else
+               s->block = (spine_block *)MALLOC ( s->maxblocks *
+                                                  sizeof ( spine_block ) );
+     }
+
+     k = s->block + s->blocks++;
+     k->first = b->first;
+     k->count = b->count;
+     k->values = (DATATYPE *)MALLOC ( s->entries * b->count *
+                                      sizeof ( DATATYPE ) );
+     k->filled = (char *)MALLOC ( s->entries );
+     memset ( k->filled, 0, s->entries );
+     return k;
+}
+
+/* spine_column()
+ *
+ * returns the parent's column for the subtree at offset q of its tree, if
+ * it was saved for the block b and matches the given hash and length.
+ */
+
+static DATATYPE *lookup_column ( spine *s, int whichtree, int q,
+                                 unsigned long long hash, int span,
+                                 batchinfo *b )
+{
+     spine_block *k;
+     int e;
+
+     if ( s->cases != b->cases || s->whichtree != whichtree ||
+          q < 0 || q >= s->lnodes || ( e = s->entry[q] ) == -1 ||
+          s->hash[e] != hash || s->span[e] != span )
+          return NULL;
+
+     k = find_block ( s, b, 0 );
+     if ( k == NULL || !k->filled[e] )
+          return NULL;
+     return k->values + e * b->count;
+}
+
+DATATYPE *spine_column ( spine *s, int whichtree, int q,
+                         unsigned long long hash, int span, batchinfo *b )
+{
+     DATATYPE *c = lookup_column ( s, whichtree, q, hash, span, b );
+
+     atomic_fetch_add_explicit ( c ? &reused : &computed, 1,
+                                 memory_order_relaxed );
+     return c;
+}
+
+/* spine_save()
+ *
+ * saves the column of the subtree at offset p, if p is one of the spine's
+ * entries.
+ */
+
+void spine_save ( spine *s, int p, batchinfo *b, DATATYPE *values )
+{
+     spine_block *k;
+     int e = s->entry[p];
+
+     if ( e == -1 || ( k = find_block ( s, b, 1 ) ) == NULL )
+          return;
+
+     memcpy ( k->values + e * b->count, values,
+              b->count * sizeof ( DATATYPE ) );
+     k->filled[e] = 1;
+}
+
+/* spine_inherit()
+ *
+ * when the subtree at offset p of s was copied whole from the parent's
+ * spine at offset q, this copies the columns of the entries inside it
+ * along as well, so they can be handed down another generation.
+ */
+
+void spine_inherit ( spine *s, spine *from, int whichtree, int p, int q,
+                     int span, batchinfo *b )
+{
+     DATATYPE *c;
+     int i, e;
+
+     for ( i = p+1; i < p+span; ++i )
+          if ( ( e = s->entry[i] ) != -1 )
+          {
+               c = lookup_column ( from, whichtree, q+i-p, s->hash[e],
+                                   s->span[e], b );
+               if ( c )
+                    spine_save ( s, i, b, c );
+          }
+}
@@ -113,7 +113,7 @@ int select_tournament ( sel_context *sc )
      for ( i = 0; i < td->count; ++i )
      {
 	  /* pick another individual. */
-          k = random_int ( &globrand, p->size );
+          k = random_int ( get_randomgen(), p->size );
 	  /* save it if it is better than the current best. */
           if ( j == -1 || p->ind[k].a_fitness > p->ind[j].a_fitness )
                j = k;
@@ -226,7 +226,7 @@ void print_tree_array_recurse ( lnode **l, int *index )
      {
           if ( f->ephem_gen )
           {
-               fprintf ( stderr, "%3d:    value: %s\n", *index, (f->ephem_str)((**l).d->d) );
+               fprintf ( stderr, "%3d:    value: %s\n", *index, (f->ephem_str)((**l).d) );
                ++*l;
                ++*index;
           }
@@ -281,10 +281,7 @@ void print_tree_recurse ( lnode **l, FILE *fil )
      ++*l;
      if ( f->ephem_gen )
      {
-          fprintf ( fil, "%s", (f->ephem_str)((**l).d->d) );
-#ifdef DEBUG
-          fprintf ( fil, " <%d>", (**l).d->refcount );
-#endif
+          fprintf ( fil, "%s", (f->ephem_str)((**l).d) );
           ++*l;
      }
      else
@@ -336,7 +333,7 @@ int generate_random_full_tree ( int space, int depth, function_set *fset, int re
                return 1;
           
           /* Randomly select the terminal and add it to the tree */
-          i = random_int(&globrand, fset->terminal_count_by_type[return_type])+
+          i = random_int(get_randomgen(), fset->terminal_count_by_type[return_type])+
 	      (fset->function_count_by_type[return_type]);
           gensp_next(space)->f = (fset->cset_by_type[return_type])+i;
 
@@ -381,7 +378,7 @@ int generate_random_full_tree ( int space, int depth, function_set *fset, int re
 
           /* Generate unique function (not at depth 0) */
           do {
-               i = random_int(&globrand, fset->function_count_by_type[return_type]);
+               i = random_int(get_randomgen(), fset->function_count_by_type[return_type]);
           } while ( f_used[i] );
           /* Mark function used */
           f_used[i] = 1;
@@ -441,7 +438,7 @@ int generate_random_grow_tree ( int space, int depth, function_set *fset, int re
      int sel_term = 0;
 
      /* Calculate whether a function or terminal is selected */
-     if ( random_double ( &globrand ) >= (double) num_func / (double) num_node )
+     if ( random_double ( get_randomgen() ) >= (double) num_func / (double) num_node )
           sel_term = 1;
      
      /* Reached maximum depth so choose terminal */
@@ -451,7 +448,7 @@ int generate_random_grow_tree ( int space, int depth, function_set *fset, int re
           if ( fset->terminal_count_by_type[return_type] == 0 )
                return 1;
 
-          i = random_int(&globrand, fset->terminal_count_by_type[return_type])+
+          i = random_int(get_randomgen(), fset->terminal_count_by_type[return_type])+
 	      (fset->function_count_by_type[return_type]);
           gensp_next(space)->f = (fset->cset_by_type[return_type])+i;
 
@@ -494,7 +491,7 @@ int generate_random_grow_tree ( int space, int depth, function_set *fset, int re
 
           /* Generate unique function (not at depth 0) */
           do {
-               i = random_int(&globrand, fset->function_count_by_type[return_type]);
+               i = random_int(get_randomgen(), fset->function_count_by_type[return_type]);
           } while ( f_used[i] );
           /* Mark function used */
           f_used[i] = 1;
@@ -592,6 +589,46 @@ int tree_depth_recurse ( lnode **l )
      return k+1;
 }
 
+/*
+ * measure_tree:  fills in the cached node counts and depth of a tree in
+ *     one walk over its data.
+ */
+
+void measure_tree ( tree *t )
+{
+     lnode *l = t->data;
+     t->nodes = t->internal = 0;
+     t->depth = measure_tree_recurse ( &l, t );
+}
+
+int measure_tree_recurse ( lnode **l, tree *t )
+{
+     function *f = (**l).f;
+     int i, j, k = 0;
+
+     ++*l;
+     ++t->nodes;
+     if ( f->arity == 0 )
+     {
+          if ( f->ephem_gen )
+               ++*l;
+          return 0;
+     }
+
+     ++t->internal;
+     for ( i = 0; i < f->arity; ++i )
+     {
+          /* skip the pointer over the skipsize node. */
+          if ( f->type == FUNC_EXPR || f->type == EVAL_EXPR )
+               ++*l;
+          j = measure_tree_recurse ( l, t );
+          if ( j > k )
+               k = j;
+     }
+
+     return k+1;
+}
+
 int tree_depth_to_subtree ( lnode *data, lnode *sub )
 {
      lnode *l = data;
@@ -841,22 +878,44 @@ lnode *get_subtree_external_recurse ( lnode **l, int *c )
 
 void copy_tree ( tree *to, tree *from )
 {
-     to->data = (lnode *)MALLOC ( from->size * sizeof ( lnode ) );
+     allocate_tree ( to, from->size );
      to->size = from->size;
      to->nodes = from->nodes;
+     to->internal = from->internal;
+     to->depth = from->depth;
      memcpy ( to->data, from->data, from->size * sizeof ( lnode ) );
 }
 
+/*
+ * allocate_tree:  gets space for size lnodes in t->data, from the calling
+ *     thread's arena if it is bound to one and from the heap otherwise.
+ */
+
+void allocate_tree ( tree *t, int size )
+{
+     t->data = arena_alloc ( size );
+     t->inarena = (t->data != NULL);
+     t->offsets = NULL;
+     if ( t->data == NULL )
+          t->data = (lnode *)MALLOC ( size * sizeof ( lnode ) );
+}
+
 /*
  * free_tree:  frees the memory allocated by a tree, and resets variables.
+ *     trees in an arena are released along with the whole arena.
  */
 
 void free_tree ( tree *t )
 {
-     FREE ( t->data );
+     free_tree_offsets ( t );
+     if ( !t->inarena )
+          FREE ( t->data );
+     t->inarena = 0;
      t->data = NULL;
      t->size = -1;
      t->nodes = -1;
+     t->internal = -1;
+     t->depth = -1;
 }
 
 /*
@@ -911,6 +970,66 @@ int tree_size_recurse ( lnode **l )
 
 }
 
+/*
+ * tree_hash:  returns a hash of the tree's structure, built from the
+ *     function index of each node and the value of each ERC.  two trees
+ *     that compute the same program the same way hash equal even if they
+ *     live at different addresses or use different ERC records.  the hash
+ *     is folded into h, so several trees can be chained together.
+ */
+
+#define HASH_PRIME 1099511628211ULL
+
+unsigned long long tree_hash ( lnode *data, unsigned long long h )
+{
+     lnode *l = data;
+     return tree_hash_recurse ( &l, h );
+}
+
+unsigned long long tree_hash_recurse ( lnode **l, unsigned long long h )
+{
+     function *f = (**l).f;
+     unsigned char *c;
+     int i;
+
+     ++*l;
+
+     h = (h ^ (unsigned long long)(f->index+1)) * HASH_PRIME;
+
+     if ( f->arity == 0 )
+     {
+          if ( f->ephem_gen )
+          {
+	       /* mix in the bytes of the constant. */
+               c = (unsigned char *)&((**l).d);
+               for ( i = 0; i < (int)sizeof ( DATATYPE ); ++i )
+                    h = (h ^ c[i]) * HASH_PRIME;
+               ++*l;
+          }
+     }
+     else
+     {
+          switch ( f->type )
+          {
+             case FUNC_DATA:
+             case EVAL_DATA:
+               for ( i = 0; i < f->arity; ++i )
+                    h = tree_hash_recurse ( l, h );
+               break;
+             case FUNC_EXPR:
+             case EVAL_EXPR:
+               for ( i = 0; i < f->arity; ++i )
+               {
+                    ++*l;
+                    h = tree_hash_recurse ( l, h );
+               }
+               break;
+          }
+     }
+
+     return h;
+}
+
 /*
  * copy_tree_replace_many:  copies a tree, replacing some of its subtrees
  *     with other subtrees.  arguments:
@@ -986,7 +1105,7 @@ void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
      {
           if ( f->ephem_gen )
           {
-               /* copy the ERC pointer. */
+               /* copy the ERC value. */
 
                gensp_next(space)->d = (**lp).d;
                ++*lp;
@@ -1026,73 +1145,71 @@ void copy_tree_replace_many_recurse ( int space, lnode **lp, lnode **lr,
 }
 
 /*
- * skip_over_subtree:  takes a traversal pointer and skips it over the
- *     subtree it points to.
+ * fset_has_skips:  returns 1 if trees built from the function set can hold
+ *     skip nodes, that is if it has FUNC_EXPR or EVAL_EXPR functions.
  */
 
-void skip_over_subtree ( lnode **l )
+int fset_has_skips ( function_set *fs )
 {
-     function *f = (**l).f;
      int i;
 
-     ++*l;
-     if ( f->arity == 0 )
-     {
-          if ( f->ephem_gen )
-               ++*l;
-     }
-     else
-     {
-          switch ( f->type )
-          {
-             case FUNC_DATA:
-             case EVAL_DATA:
-               for ( i = 0; i < f->arity; ++i )
-                    skip_over_subtree ( l );
-               break;
-             case FUNC_EXPR:
-             case EVAL_EXPR:
-               for ( i = 0; i < f->arity; ++i )
-               {
-                    ++*l;
-                    skip_over_subtree ( l );
-               }
-               break;
-          }
-     }
-     return;
+     for ( i = 0; i < fs->size; ++i )
+          if ( fs->cset[i].type == FUNC_EXPR || fs->cset[i].type == EVAL_EXPR )
+               return 1;
+     return 0;
 }
 
 /*
- * reference_ephem_constants:  traverses a tree, adding "count" to the
- *     refcount of each ERC that is used within the tree.
+ * splice_tree:  builds, in the given genspace, a copy of the parent with
+ *     the subtree at cut replaced by the withsize lnodes at with, as
+ *     copy_tree_replace_many() does for a single replacement.  when the
+ *     tree's function set has no skip nodes nothing in the copy has to be
+ *     fixed up, so it is built from three blocks instead of node by node:
+ *     the parent before the cut, the donor, and the parent after the cut
+ *     subtree.
  */
 
-void reference_ephem_constants ( lnode *data, int count )
+void splice_tree ( int space, tree *parent, int whichtree, lnode *cut,
+                   lnode *with, int withsize )
 {
-     lnode *l = data;
-     reference_ephem_constants_recurse ( &l, count );
+     int at = cut - parent->data;
+     int cutsize, rest, repcount;
+     lnode *l;
+
+     if ( fset_has_skips ( fset+tree_map[whichtree].fset ) )
+     {
+          copy_tree_replace_many ( space, parent->data, &cut, &with, 1,
+                                  &repcount );
+          if ( repcount != 1 )
+               error ( E_FATAL_ERROR, "botched splice:  this can't happen" );
+          return;
+     }
+
+     cutsize = point_size ( parent, cut );
+     rest = parent->size - at - cutsize;
+
+     gensp_reset ( space );
+     l = gensp_next_block ( space, at + withsize + rest );
+     memcpy ( l, parent->data, at * sizeof ( lnode ) );
+     memcpy ( l+at, with, withsize * sizeof ( lnode ) );
+     memcpy ( l+at+withsize, cut+cutsize, rest * sizeof ( lnode ) );
 }
 
-void reference_ephem_constants_recurse ( lnode **l, int count )
+/*
+ * skip_over_subtree:  takes a traversal pointer and skips it over the
+ *     subtree it points to.
+ */
+
+void skip_over_subtree ( lnode **l )
 {
      function *f = (**l).f;
      int i;
 
      ++*l;
-
      if ( f->arity == 0 )
      {
           if ( f->ephem_gen )
-          {
-               if ( (**l).d )
-               {
-                    (**l).d->refcount += count;
-                    ++*l;
-               }
-               else
-                    error ( E_FATAL_ERROR, "aarg: this can't happen." );
-          }
+               ++*l;
      }
      else
      {
@@ -1101,19 +1218,18 @@ void reference_ephem_constants_recurse ( lnode **l, int count )
              case FUNC_DATA:
              case EVAL_DATA:
                for ( i = 0; i < f->arity; ++i )
-                    reference_ephem_constants_recurse ( l, count );
+                    skip_over_subtree ( l );
                break;
              case FUNC_EXPR:
              case EVAL_EXPR:
                for ( i = 0; i < f->arity; ++i )
                {
                     ++*l;
-                    reference_ephem_constants_recurse ( l, count );
+                    skip_over_subtree ( l );
                }
                break;
           }
      }
-
+     return;
 }
 
-
@@ -36,6 +36,17 @@ typedef struct
     char* name;			/* tree name */
 } user_treeinfo;
 
+/* describes one block of fitness cases handed to the batch evaluator.
+   what "cases" points to is up to the application; the kernel only passes
+   it through to the vectorized function code. */
+
+typedef struct
+{
+     void *cases;
+     int first;        /* index of the first case in the block */
+     int count;        /* number of cases in the block */
+} batchinfo;
+
 /* holds information about one function (or terminal). */
 
 typedef struct
@@ -51,6 +62,9 @@ typedef struct
      /* Added to support strong data typing */
      int return_type;
      int argument_type[MAXARGS];
+     /* Added to support batch evaluation:  computes out[0..count-1] from
+        the argument columns in one call. */
+     void (*vcode)( int, batchinfo *, DATATYPE *, DATATYPE ** );
 } function;
 
 typedef struct
@@ -66,35 +80,34 @@ typedef struct
      int terminal_count_by_type[NUMTYPES];
 } function_set;
 
-/* holds one ERC.  contains the data, reference count, and pointer for
-   building a linked list. */
-
-typedef struct _ephem_const
-{
-     int refcount;
-     struct _ephem_const *next;
-     DATATYPE d;
-     function *f;
-} ephem_const;
-
 /* the basic building block of the tree structure.  can be a function pointer,
-   a skip value, or a pointer to an ERC. */
+   a skip value, or the value of an ERC.  an ERC's value is kept in the lnode
+   following its function, so it is copied and freed along with the tree. */
 
 typedef union
 {
      int s;
      function *f;
-     ephem_const *d;
+     DATATYPE d;
 } lnode;
 
-/* one tree -- consists of an array of lnodes.  the size and node counts are
-   cached here for speed improvement. */
+/* where each node of a tree is and the size of the subtree there; see
+   offsets.c. */
+
+typedef struct _tree_offsets tree_offsets;
+
+/* one tree -- consists of an array of lnodes.  the size, node counts and
+   depth are cached here for speed improvement. */
 
 typedef struct _tree
 {
      lnode *data;
      int size;         /* the lnode count */
      int nodes;        /* the actual node count */
+     int internal;     /* how many of the nodes are functions */
+     int depth;
+     int inarena;      /* data belongs to a population's arena, not the heap */
+     tree_offsets *offsets;    /* built on demand by get_tree_offsets() */
 } tree;
 
 /* the arguments passed to the function (terminal) code.  can be either a
@@ -106,6 +119,19 @@ typedef union
      lnode *t;
 } farg;
 
+/* the columns an individual saved when it was evaluated, and what it
+   inherited from its parent for its own evaluation (see spine.c). */
+
+typedef struct _spine spine;
+
+typedef struct
+{
+     spine *own;       /* columns saved when this individual was evaluated */
+     spine *from;      /* the parent's columns, until this one is evaluated */
+     int edit;         /* lnode offset just past the spliced-in subtree, or -1 */
+     int shift;        /* how far lnodes from edit on were moved by the splice */
+} lineage;
+
 /* one individual.  holds the expression, fitness values, etc. */
 
 typedef struct
@@ -117,6 +143,7 @@ typedef struct
      int hits;
      int evald;
      int flags;
+     lineage ln;
 } individual;
 
 /* struct for doing a binary search of successive real-valued intervals. */
@@ -127,6 +154,22 @@ typedef struct
      int index;
 } reverse_index;
 
+/* a tree compiled to straight-line code; see compile.c. */
+
+typedef struct _compiled_tree compiled_tree;
+
+/* a tree packed into 16-bit opcodes and a pool of constants; see packed.c. */
+
+typedef struct _packed_tree packed_tree;
+
+/* a per-population block allocator for tree storage; see arena.c. */
+
+typedef struct _tree_arena tree_arena;
+
+/* statistics of a population gathered while it is evaluated; see gp.c. */
+
+typedef struct _pop_summary pop_summary;
+
 /* one population -- an array of individuals, and some global info. */
 
 typedef struct
@@ -134,6 +177,8 @@ typedef struct
      individual *ind;
      int size;
      int next;
+     tree_arena *arena;  /* holds the trees; NULL if they are all on the heap */
+     pop_summary *summary;  /* taken by calculate_pop_stats(); may be NULL */
 } population;
 
 struct _sel_context;
@@ -198,12 +243,6 @@ typedef struct
      int count;
 } interval_data;
 
-typedef struct
-{
-     int i;
-     ephem_const *e;
-} ephem_index;
-     
 typedef struct _parameter
 {
      char *n;
@@ -231,6 +270,34 @@ typedef struct _popstats
      saved_ind **best;
 } popstats;
 
+/* the .stb file is an stb_header followed by one stb_record for each line
+   of the .stt file, written as they are in memory so that a reader can map
+   the file and use the records in place.  the fields are ordered so that
+   there is no padding between them. */
+
+typedef struct
+{
+     char magic[8];            /* STB_MAGIC, without the terminator */
+     int version;
+     int recsize;              /* sizeof ( stb_record ) */
+} stb_header;
+
+typedef struct
+{
+     double meanfit, bestfit, worstfit;
+     double meannodes, meandepth;
+     int bestnodes, bestdepth;
+     int worstnodes, worstdepth;
+} stb_stats;
+
+typedef struct
+{
+     int gen;
+     int sub;                  /* subpopulation, or 0 for the whole */
+     stb_stats g;              /* this generation */
+     stb_stats r;              /* the run so far */
+} stb_record;
+
 typedef struct 
 {
      lnode *data;
@@ -254,7 +321,6 @@ typedef struct
 {
      double mbig, mseed, mz, ma[55];
      int inext, inextp;
-     pthread_mutex_t rmut;
 } randomgen;
 
 #endif
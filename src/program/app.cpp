@@ -36,6 +36,7 @@
 #include "blt/std/memory_util.h"
 #include "blt/std/error.h"
 #include "rice_loader.h"
+#include "dataset.h"
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/un.h>
@@ -46,6 +47,11 @@
 #include <fcntl.h>
 #include <queue>
 #include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 extern "C" {
 #include <lilgp.h>
@@ -69,12 +75,24 @@ int our_socket;
 
 
 static int fitness_cases = -1;
+// shared, read-only tables of fitness cases. the training table drives evolution, the testing table is only used
+// to report how the best individual generalizes.
+static std::unique_ptr<fitness_dataset> training_cases;
 #ifdef PART_B
-static double* app_fitness_cases[8];
-#else
-static double* app_fitness_cases[2];
+static std::unique_ptr<fitness_dataset> testing_cases;
 #endif
 static double value_cutoff;
+// evaluate each tree over a block of fitness cases at a time instead of one case at a time
+static bool batch_eval = false;
+// cases per block; small enough that the scratch columns of a deep tree stay in cache
+static constexpr int batch_block = 256;
+// the form an individual's tree is run in over the cases
+enum class eval_format
+{
+    tree, compiled, packed
+};
+// the form used for the training cases; the best of run is always compiled for the testing cases
+static eval_format training_format = eval_format::tree;
 
 // required for this to work with c++
 template<typename T>
@@ -162,6 +180,257 @@ void handle_networking()
     };
 }
 
+// an individual's tree in the form it is run in, freed when this goes out of scope. trees that can't be
+// compiled or packed are run as they are.
+class runnable_tree
+{
+    public:
+        runnable_tree(individual* ind, eval_format format): runnable_tree(ind->tr[0].data, format, false)
+        {}
+        
+        // a detached tree is a copy that belongs to no individual in the population. as a plain tree it is only run
+        // case by case, since the batch evaluator may use the subtree memo, which is cleared between generations.
+        runnable_tree(lnode* tree, eval_format format, bool detached): tree(tree), detached(detached)
+        {
+            if (format == eval_format::compiled)
+                compiled = compile_tree(tree, 0);
+            else if (format == eval_format::packed)
+                packed = pack_tree(tree, 0);
+        }
+        
+        runnable_tree(const runnable_tree&) = delete;
+        runnable_tree& operator=(const runnable_tree&) = delete;
+        
+        ~runnable_tree()
+        {
+            free_compiled_tree(compiled);
+            free_packed_tree(packed);
+        }
+        
+        // the value for the current case
+        double run() const
+        {
+            if (compiled)
+                return evaluate_compiled(compiled);
+            if (packed)
+                return evaluate_packed(packed);
+            return evaluate_tree(tree, 0);
+        }
+        
+        // whether run() may be given a block of cases
+        bool batchable() const
+        {
+            return compiled || packed || !detached;
+        }
+        
+        // the values for a block of cases
+        void run(batchinfo* b, double* out) const
+        {
+            if (compiled)
+                evaluate_compiled_batch(compiled, b, out);
+            else if (packed)
+                evaluate_packed_batch(packed, b, out);
+            else
+                evaluate_tree_batch(tree, 0, b, out);
+        }
+    
+    private:
+        lnode* tree;
+        bool detached;
+        compiled_tree* compiled = nullptr;
+        packed_tree* packed = nullptr;
+};
+
+// evaluates the tree over the cases in the table a block at a time, handing each result to score(case, value).
+// after each block stop(cases done) may end the evaluation early; returns false if it did.
+template<typename F, typename S>
+static bool app_evaluate_cases(const runnable_tree& prog, const fitness_dataset& cases, F&& score, S&& stop)
+{
+    int i, first, count;
+    
+    if (batch_eval && prog.batchable())
+    {
+        double values[batch_block];
+        batchinfo b{const_cast<fitness_dataset*>(&cases), 0, 0};
+        
+        for (b.first = 0; b.first < cases.size(); b.first += batch_block)
+        {
+            if (b.first > 0 && stop(b.first))
+                return false;
+            b.count = std::min(batch_block, cases.size() - b.first);
+            prog.run(&b, values);
+            for (i = 0; i < b.count; ++i)
+                score(b.first + i, values[i]);
+        }
+    } else
+    {
+        globaldata* g = get_globaldata();
+        
+        g->cases = &cases;
+        for (first = 0; first < cases.size(); first += batch_block)
+        {
+            if (first > 0 && stop(first))
+                return false;
+            count = std::min(batch_block, cases.size() - first);
+            for (i = first; i < first + count; ++i)
+            {
+                g->case_index = i;
+                score(i, prog.run());
+            }
+        }
+    }
+    return true;
+}
+
+template<typename F>
+static void app_evaluate_cases(const runnable_tree& prog, const fitness_dataset& cases, F&& score)
+{
+    app_evaluate_cases(prog, cases, std::forward<F>(score), [](int) { return false; });
+}
+
+// a copy of a best-of-run individual, taken so it can be scored and printed while the population moves on.
+struct best_snapshot
+{
+    std::vector<lnode> tree;
+    double fitness;
+    int hits;
+    // whether the scores are printed as well as the tree
+    bool detail;
+};
+
+// scores each new best of run over the testing cases and formats its .fn file on a thread of its own, so the next
+// generation doesn't wait on it. only the newest best is worth the work: one that is replaced before its turn comes
+// is dropped. the text is handed back to the main thread, which owns the output streams, to be written.
+class best_validator
+{
+    public:
+        void start()
+        {
+            // the validator runs trees case by case with a 'g' of its own.
+            globaldata g = *get_globaldata();
+            g.current_individual = nullptr;
+            thread = std::thread(&best_validator::run, this, g);
+        }
+        
+        void submit(best_snapshot&& snapshot)
+        {
+            {
+                std::scoped_lock lock(mutex);
+                pending = std::move(snapshot);
+            }
+            cv.notify_one();
+        }
+        
+        // writes the .fn file of the last best that was finished, if it hasn't been written yet.
+        void publish()
+        {
+            std::optional<std::string> text;
+            {
+                std::scoped_lock lock(mutex);
+                text.swap(done);
+            }
+            if (!text)
+                return;
+            output_stream_open(OUT_USER);
+            fputs(text->c_str(), output_filehandle(OUT_USER));
+            output_stream_close(OUT_USER);
+        }
+        
+        // finishes the outstanding work, writes it, and stops the thread.
+        void stop()
+        {
+            if (!thread.joinable())
+                return;
+            {
+                std::scoped_lock lock(mutex);
+                quit = true;
+            }
+            cv.notify_one();
+            thread.join();
+            publish();
+        }
+    
+    private:
+        void run(globaldata g)
+        {
+            set_globaldata(&g);
+            std::unique_lock lock(mutex);
+            while (true)
+            {
+                cv.wait(lock, [this]() { return pending || quit; });
+                if (!pending)
+                    break;
+                auto snapshot = std::move(*pending);
+                pending.reset();
+                lock.unlock();
+                auto text = format(snapshot);
+                lock.lock();
+                done = std::move(text);
+            }
+        }
+        
+        static std::string format(best_snapshot& snapshot)
+        {
+            char* buffer = nullptr;
+            size_t length = 0;
+            FILE* f = open_memstream(&buffer, &length);
+            
+#ifdef PART_B
+            const auto& testing = *testing_cases;
+            const double* expected = testing.column(COL_CLASS);
+            
+            annoying results;
+            
+            // the best of run is scored over the whole testing set, so it is worth compiling first.
+            runnable_tree prog(snapshot.tree.data(), eval_format::compiled, true);
+            app_evaluate_cases(prog, testing, [&](int i, double v) {
+                auto dv = expected[i] > 0;
+                
+                // (real value) (predicted value)
+                if (dv)
+                {
+                    if (v >= 0)
+                        results.cc++; // cammeo cammeo
+                    else if (v < 0)
+                        results.co++; // cammeo osmancik
+                } else
+                {
+                    if (v < 0)
+                        results.oo++; // osmancik osmancik
+                    else if (v >= 0)
+                        results.oc++; // osmancik cammeo
+                }
+            });
+            
+            if (snapshot.detail)
+            {
+                fprintf(f, "Hits: %ld, Total Size: %d, Percent Hit: %lf\n", results.cc + results.oo, testing.size(),
+                        static_cast<double>(results.cc + results.oo) / static_cast<double>(testing.size()) * 100);
+                fprintf(f, "CC: %ld\nCO: %ld\nOO: %ld\nOC: %ld\n", results.cc, results.co, results.oo, results.oc);
+                fprintf(f, "Fitness: %lf\n", snapshot.fitness);
+                fprintf(f, "Hits: %d\n", snapshot.hits);
+                fprintf(f, "\n");
+            }
+#endif
+            pretty_print_tree_equ(snapshot.tree.data(), f);
+            pretty_print_tree(snapshot.tree.data(), f);
+            
+            fclose(f);
+            std::string text(buffer, length);
+            free(buffer);
+            return text;
+        }
+        
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::optional<best_snapshot> pending;
+        std::optional<std::string> done;
+        bool quit = false;
+};
+
+static best_validator validator;
+
 extern "C" void app_begin_of_evaluation(int gen, multipop* mpop)
 {
     BLT_INFO("Running begin of eval, current state: are we paused? %s num of gens left %d", paused ? "true" : "false", generations_left.load());
@@ -193,65 +462,19 @@ extern "C" int app_end_of_evaluation(int gen, multipop* mpop, int newbest, popst
     set_current_individual(gen_stats[0].best[0]->ind);
     best_individual.store(gen_stats[0].best[0]->ind->a_fitness);
     
+    // write out the last best of run, if the validator has finished with it since.
+    validator.publish();
+    
     if (newbest)
     {
-        output_stream_open(OUT_USER);
-        
         auto ind = run_stats[0].best[0]->ind;
-
-#ifdef PART_B
-        //oprintf(OUT_USER, 20, "(%lf, %lf)\n", g->x, v);
-        globaldata* g = get_globaldata();
-        if (g->current_individual != ind)
-        {
-            BLT_WARN("Huh!?!?!?!?!?");
-        }
-        set_current_individual(ind);
-        best_individual.store(gen_stats[0].best[0]->ind->a_fitness);
-        
-        auto testing = rice_data.getTestingSet();
         
-        annoying results;
-        
-        for (const auto& r : testing)
-        {
-            g->area = r.area;
-            g->perimeter = r.perimeter;
-            g->major_axis_length = r.major_axis_length;
-            g->minor_axis_length = r.minor_axis_length;
-            g->eccentricity = r.eccentricity;
-            g->convex_area = r.convex_area;
-            g->extent = r.extent;
-            auto dv = r.type[0] == 'C';
-            auto v = evaluate_tree(ind->tr[0].data, 0);
-            
-            // (real value) (predicted value)
-            if (dv)
-            {
-                if (v >= 0)
-                    results.cc++; // cammeo cammeo
-                else if (v < 0)
-                    results.co++; // cammeo osmancik
-            } else
-            {
-                if (v < 0)
-                    results.oo++; // osmancik osmancik
-                else if (v >= 0)
-                    results.oc++; // osmancik cammeo
-            }
-        }
-        
-        oprintf(OUT_USER, 50, "Hits: %ld, Total Size: %ld, Percent Hit: %lf\n", results.cc + results.oo, testing.size(),
-                static_cast<double>(results.cc + results.oo) / static_cast<double>(testing.size()) * 100);
-        oprintf(OUT_USER, 50, "CC: %ld\nCO: %ld\nOO: %ld\nOC: %ld\n", results.cc, results.co, results.oo, results.oc);
-        oprintf(OUT_USER, 50, "Fitness: %lf\n", ind->a_fitness);
-        oprintf(OUT_USER, 50, "Hits: %d\n", ind->hits);
-        oprintf(OUT_USER, 50, "\n");
-#endif
-        pretty_print_tree_equ(ind->tr[0].data, output_filehandle(OUT_USER));
-        pretty_print_tree(ind->tr[0].data, output_filehandle(OUT_USER));
-        
-        output_stream_close(OUT_USER);
+        best_snapshot snapshot;
+        snapshot.tree.assign(ind->tr[0].data, ind->tr[0].data + ind->tr[0].size);
+        snapshot.fitness = ind->a_fitness;
+        snapshot.hits = ind->hits;
+        snapshot.detail = test_detail_level(50);
+        validator.submit(std::move(snapshot));
         
         if (run_stats[0].best[0]->ind->hits == fitness_cases)
             return 1;
@@ -350,18 +573,10 @@ extern "C" int app_initialize(int startfromcheckpoint)
         }
 
 #ifdef PART_B
-        app_fitness_cases[0] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[1] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[2] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[3] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[4] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[5] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[6] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[7] = (double*) MALLOC(fitness_cases * sizeof(double));
-        auto data = rice_data.getTrainingSet(fitness_cases);
+        const auto& data = rice_data.getTrainingSet(fitness_cases);
+        training_cases.reset(make_rice_dataset(data, fitness_cases));
 #else
-        app_fitness_cases[0] = (double*) MALLOC(fitness_cases * sizeof(double));
-        app_fitness_cases[1] = (double*) MALLOC(fitness_cases * sizeof(double));
+        training_cases = std::make_unique<fitness_dataset>(fitness_cases);
 #endif
         
         oprintf(OUT_PRG, 50, "%d fitness cases:\n", fitness_cases);
@@ -377,18 +592,10 @@ extern "C" int app_initialize(int startfromcheckpoint)
 ////            y = x * cos(x) + sin(x) * log(x + x * x + x) + x * x;
 ///*			y = x*x; */
             
-            app_fitness_cases[0][i] = x;
-            app_fitness_cases[1][i] = y;
+            training_cases->column(COL_X)[i] = x;
+            training_cases->column(COL_Y)[i] = y;
             oprintf(OUT_PRG, 50, "    x = %12.5lf, y = %12.5lf\n", x, y);
 #else
-            app_fitness_cases[0][i] = data[i].area;
-            app_fitness_cases[1][i] = data[i].perimeter;
-            app_fitness_cases[2][i] = data[i].major_axis_length;
-            app_fitness_cases[3][i] = data[i].minor_axis_length;
-            app_fitness_cases[4][i] = data[i].eccentricity;
-            app_fitness_cases[5][i] = data[i].convex_area;
-            app_fitness_cases[6][i] = data[i].extent;
-            app_fitness_cases[7][i] = (data[i].type[0] == 'C') ? 50 : -50;
             oprintf(OUT_PRG, 50,
                     "    area = %12.5lf, perimeter = %12.5lf, major_axis_length = %12.5lf, minor_axis_length = %12.5lf, eccentricity = %12.5lf, convex_area = %12.5lf, extent = %12.5lf, type = %c\n",
                     data[i].area, data[i].perimeter, data[i].major_axis_length, data[i].minor_axis_length, data[i].eccentricity, data[i].convex_area,
@@ -401,24 +608,56 @@ extern "C" int app_initialize(int startfromcheckpoint)
         oprintf(OUT_PRG, 50, "started from checkpoint file.\n");
     }
     
+#ifdef PART_B
+    // everything not handed out as training data is used for testing.
+    const auto& testing = rice_data.getTestingSet();
+    testing_cases.reset(make_rice_dataset(testing, testing.size()));
+#endif
+    
     param = get_parameter("app.value_cutoff");
     if (param == NULL)
         value_cutoff = 1.e15;
     else
         value_cutoff = strtod(param, NULL);
     
+    binary_parameter("app.batch_eval", 1);
+    batch_eval = atoi(get_parameter("app.batch_eval"));
+    if (batch_eval && !evaluate_batch_capable(0))
+    {
+        error(E_WARNING, "function set cannot be batch evaluated; using per-case evaluation.");
+        batch_eval = false;
+    }
+    oprintf(OUT_SYS, 30, "    %s evaluation.\n", batch_eval ? "batch" : "per-case");
+    
+    param = get_parameter("app.eval_format");
+    if (param == NULL || strcmp(param, "tree") == 0)
+        training_format = eval_format::tree;
+    else if (strcmp(param, "compiled") == 0)
+        training_format = eval_format::compiled;
+    else if (strcmp(param, "packed") == 0)
+        training_format = eval_format::packed;
+    else
+        error(E_FATAL_ERROR, "app.eval_format must be \"tree\", \"compiled\" or \"packed\".");
+    if (training_format != eval_format::tree)
+        oprintf(OUT_SYS, 30, "    individuals %s before evaluation.\n", param);
+    
+    validator.start();
+    
     return 0;
 }
 
 extern "C" void app_uninitialize(void)
 {
+    validator.stop();
     running = false;
     if (network_thread->joinable())
         network_thread->join();
     network_thread = nullptr;
     close(our_socket);
-    FREE(app_fitness_cases[0]);
-    FREE(app_fitness_cases[1]);
+    training_cases = nullptr;
+#ifdef PART_B
+    testing_cases = nullptr;
+#endif
 }
 
 extern "C" void app_end_of_breeding(int gen, multipop* mpop)
@@ -436,26 +675,26 @@ extern "C" int app_build_function_sets(void)
     function_set fset;
     user_treeinfo tree_map;
     function sets[] =
-            {{cxx_d(f_multiply), nullptr, nullptr, 2, "*", FUNC_DATA, -1, 0, 0, {0, 0}},
-             {cxx_d(f_protdivide), nullptr, nullptr, 2, "/", FUNC_DATA, -1, 0, 0, {0, 0}},
-             {cxx_d(f_add), nullptr, nullptr, 2, "+", FUNC_DATA, -1, 0, 0, {0, 0}},
-             {cxx_d(f_subtract), nullptr, nullptr, 2, "-", FUNC_DATA, -1, 0, 0, {0, 0}},
-             {cxx_d(f_exp), nullptr, nullptr, 1, "exp", FUNC_DATA, -1, 0, 0, {0, 0}},
-             {cxx_d(f_rlog), nullptr, nullptr, 1, "log", FUNC_DATA, -1, 0, 0, {0, 0}},
+            {{cxx_d(f_multiply), nullptr, nullptr, 2, "*", FUNC_DATA, -1, 0, 0, {0, 0}, v_multiply},
+             {cxx_d(f_protdivide), nullptr, nullptr, 2, "/", FUNC_DATA, -1, 0, 0, {0, 0}, v_protdivide},
+             {cxx_d(f_add), nullptr, nullptr, 2, "+", FUNC_DATA, -1, 0, 0, {0, 0}, v_add},
+             {cxx_d(f_subtract), nullptr, nullptr, 2, "-", FUNC_DATA, -1, 0, 0, {0, 0}, v_subtract},
+             {cxx_d(f_exp), nullptr, nullptr, 1, "exp", FUNC_DATA, -1, 0, 0, {0, 0}, v_exp},
+             {cxx_d(f_rlog), nullptr, nullptr, 1, "log", FUNC_DATA, -1, 0, 0, {0, 0}, v_rlog},
 #ifndef PART_B
-                    {cxx_d(f_sin), nullptr, nullptr, 1, "sin", FUNC_DATA, -1, 0, 0, {0, 0}},
-                    {cxx_d(f_cos), nullptr, nullptr, 1, "cos", FUNC_DATA, -1, 0, 0, {0, 0}},
-                    {cxx_d(f_var), nullptr, nullptr, 0, "x", TERM_NORM, -1, 0, 0, {0, 0}},
+                    {cxx_d(f_sin), nullptr, nullptr, 1, "sin", FUNC_DATA, -1, 0, 0, {0, 0}, v_sin},
+                    {cxx_d(f_cos), nullptr, nullptr, 1, "cos", FUNC_DATA, -1, 0, 0, {0, 0}, v_cos},
+                    {cxx_d(f_var), nullptr, nullptr, 0, "x", TERM_NORM, -1, 0, 0, {0, 0}, v_var},
 #else
-             {cxx_d(f_area), nullptr, nullptr, 0, "area", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_perimeter), nullptr, nullptr, 0, "perimeter", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_major_axis_length), nullptr, nullptr, 0, "major", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_minor_axis_length), nullptr, nullptr, 0, "minor", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_eccentricity), nullptr, nullptr, 0, "eccentricity", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_convex_area), nullptr, nullptr, 0, "convex", TERM_NORM, -1, 0, 0, {0, 0}},
-             {cxx_d(f_extent), nullptr, nullptr, 0, "extent", TERM_NORM, -1, 0, 0, {0, 0}},
+             {cxx_d(f_area), nullptr, nullptr, 0, "area", TERM_NORM, -1, 0, 0, {0, 0}, v_area},
+             {cxx_d(f_perimeter), nullptr, nullptr, 0, "perimeter", TERM_NORM, -1, 0, 0, {0, 0}, v_perimeter},
+             {cxx_d(f_major_axis_length), nullptr, nullptr, 0, "major", TERM_NORM, -1, 0, 0, {0, 0}, v_major_axis_length},
+             {cxx_d(f_minor_axis_length), nullptr, nullptr, 0, "minor", TERM_NORM, -1, 0, 0, {0, 0}, v_minor_axis_length},
+             {cxx_d(f_eccentricity), nullptr, nullptr, 0, "eccentricity", TERM_NORM, -1, 0, 0, {0, 0}, v_eccentricity},
+             {cxx_d(f_convex_area), nullptr, nullptr, 0, "convex", TERM_NORM, -1, 0, 0, {0, 0}, v_convex_area},
+             {cxx_d(f_extent), nullptr, nullptr, 0, "extent", TERM_NORM, -1, 0, 0, {0, 0}, v_extent},
 #endif
-             {nullptr, f_erc_gen, cxx_c(f_erc_print), 0, "R", TERM_ERC, -1, 0, 0, {0, 0}}};
+             {nullptr, f_erc_gen, cxx_c(f_erc_print), 0, "R", TERM_ERC, -1, 0, 0, {0, 0}, nullptr}};
     
     binary_parameter("app.use_ercs", 1);
 #ifndef PART_B
@@ -479,98 +718,116 @@ extern "C" int app_build_function_sets(void)
     return function_sets_init(&fset, 1, &tree_map, 1);
 }
 
+// adds the outcome of one fitness case to the individual's raw fitness and hits.
+static inline void app_score_case(individual* ind, double v, double expected)
+{
+#ifdef PART_B
+    bool dv = expected > 0;
+    if ((v >= 0 && dv) || (v < 0 && !dv))
+        ind->hits++;
+    ind->r_fitness = ind->hits;
+#else
+    double disp = fabs(expected - v);
+    
+    if (disp < value_cutoff)
+    {
+        ind->r_fitness += disp;
+        if (disp <= 0.01)
+            ++ind->hits;
+    } else
+    {
+        ind->r_fitness += value_cutoff;
+    }
+#endif
+}
+
+static inline double app_adjusted_fitness(double s_fitness)
+{
+#ifdef PART_B
+    return 1 - (1 / (1 + s_fitness));
+#else
+    return 1 / (1 + s_fitness);
+#endif
+}
+
 extern "C" void app_eval_fitness(individual* ind)
 {
 #ifdef PART_B
-    int i;
-    double v;
-    bool dv;
+    const double* expected = training_cases->column(COL_CLASS);
 #else
-    int i;
-    double v, dv;
-    double disp;
+    const double* expected = training_cases->column(COL_Y);
 #endif
-    globaldata* g = get_globaldata();
+    const double bound = get_evaluation_bound();
+    const int total = training_cases->size();
     
     set_current_individual(ind);
     
     ind->r_fitness = 0.0;
     ind->hits = 0;
+    ind->flags &= ~FLAG_BOUNDED;
     
-    for (i = 0; i < fitness_cases; ++i)
-    {
-#ifdef PART_B
-        g->area = app_fitness_cases[0][i];
-        g->perimeter = app_fitness_cases[1][i];
-        g->major_axis_length = app_fitness_cases[2][i];
-        g->minor_axis_length = app_fitness_cases[3][i];
-        g->eccentricity = app_fitness_cases[4][i];
-        g->convex_area = app_fitness_cases[5][i];
-        g->extent = app_fitness_cases[6][i];
-        dv = app_fitness_cases[7][i] > 0;
-#else
-        g->x = app_fitness_cases[0][i];
-        dv = app_fitness_cases[1][i];
-#endif
-        v = evaluate_tree(ind->tr[0].data, 0);
+    // a compiled or packed tree skips the subtree memo and spines, which work on the tree itself.
+    runnable_tree prog(ind, training_format);
+    bool complete = app_evaluate_cases(prog, *training_cases, [ind, expected](int i, double v) {
+        app_score_case(ind, v, expected[i]);
+    }, [ind, bound, total](int done) {
 #ifdef PART_B
-        if ((v >= 0 && dv) || (v < 0 && !dv))
-            ind->hits++;
-        ind->r_fitness = ind->hits;
-        ind->s_fitness = ind->r_fitness;
-        ind->a_fitness = 1 - (1 / (1 + ind->s_fitness));
+        // even a hit on every remaining case can't lift it above the bound.
+        return app_adjusted_fitness(ind->hits + (total - done)) <= bound;
 #else
-        disp = fabs(dv - v);
-        
-        if (disp < value_cutoff)
-        {
-            ind->r_fitness += disp;
-            if (disp <= 0.01)
-                ++ind->hits;
-        } else
-        {
-            ind->r_fitness += value_cutoff;
-        }
-        ind->s_fitness = ind->r_fitness;
-        ind->a_fitness = 1 / (1 + ind->s_fitness);
+        // the error can only grow from here.
+        (void) total;
+        (void) done;
+        return app_adjusted_fitness(ind->r_fitness) <= bound;
 #endif
-    }
+    });
+    
+    // a stopped individual keeps what it scored so far; either way its fitness is no better than the bound.
+    if (!complete)
+        ind->flags |= FLAG_BOUNDED;
+    
+    ind->s_fitness = ind->r_fitness;
+    ind->a_fitness = app_adjusted_fitness(ind->s_fitness);
     
     ind->evald = EVAL_CACHE_VALID;
 }
 
 extern "C" void app_write_checkpoint(FILE* f)
 {
-    int i;
+    int i, c;
     fprintf(f, "fitness-cases: %d\n", fitness_cases);
     for (i = 0; i < fitness_cases; ++i)
     {
-        write_hex_block(app_fitness_cases[0] + i, sizeof(double), f);
-        fputc(' ', f);
-        write_hex_block(app_fitness_cases[1] + i, sizeof(double), f);
-        fprintf(f, " %.5lf %.5lf\n",
-                app_fitness_cases[0][i], app_fitness_cases[1][i]);
+        for (c = 0; c < COL_COUNT; ++c)
+        {
+            if (c)
+                fputc(' ', f);
+            write_hex_block(training_cases->column(c) + i, sizeof(double), f);
+        }
+        for (c = 0; c < COL_COUNT; ++c)
+            fprintf(f, " %.5lf", training_cases->value(c, i));
+        fputc('\n', f);
     }
 }
 
 extern "C" void app_read_checkpoint(FILE* f)
 {
-    int i;
+    int i, c;
     
     fscanf(f, "%*s %d\n", &fitness_cases);
     
-    app_fitness_cases[0] = (double*) MALLOC(fitness_cases *
-                                            sizeof(double));
-    app_fitness_cases[1] = (double*) MALLOC(fitness_cases *
-                                            sizeof(double));
+    training_cases = std::make_unique<fitness_dataset>(fitness_cases);
     
     for (i = 0; i < fitness_cases; ++i)
     {
-        read_hex_block(app_fitness_cases[0] + i, sizeof(double), f);
-        fgetc(f);
-        read_hex_block(app_fitness_cases[1] + i, sizeof(double), f);
-        fscanf(f, " %*f %*f\n");
-        fprintf(stderr, "%.5lf %.5lf\n", app_fitness_cases[0][i],
-                app_fitness_cases[1][i]);
+        for (c = 0; c < COL_COUNT; ++c)
+        {
+            if (c)
+                fgetc(f);
+            read_hex_block(training_cases->column(c) + i, sizeof(double), f);
+        }
+        for (c = 0; c < COL_COUNT; ++c)
+            fscanf(f, " %*f");
+        fscanf(f, "\n");
     }
 }
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2024  Brett Terpstra
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <dataset.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+fitness_dataset::fitness_dataset(int count): count(count)
+{
+    constexpr std::size_t per = alignment / sizeof(double);
+    stride = ((static_cast<std::size_t>(std::max(count, 1)) + per - 1) / per) * per;
+    block = static_cast<double*>(std::aligned_alloc(alignment, stride * COL_COUNT * sizeof(double)));
+    if (block == nullptr)
+        throw std::bad_alloc();
+    std::memset(block, 0, stride * COL_COUNT * sizeof(double));
+}
+
+fitness_dataset::~fitness_dataset()
+{
+    std::free(block);
+}
+
+#ifdef PART_B
+
+fitness_dataset* make_rice_dataset(const std::vector<rice_record>& records, std::size_t amount)
+{
+    amount = std::min(amount, records.size());
+    auto data = new fitness_dataset(static_cast<int>(amount));
+    for (std::size_t i = 0; i < amount; i++)
+    {
+        const auto& r = records[i];
+        data->column(COL_AREA)[i] = r.area;
+        data->column(COL_PERIMETER)[i] = r.perimeter;
+        data->column(COL_MAJOR_AXIS_LENGTH)[i] = r.major_axis_length;
+        data->column(COL_MINOR_AXIS_LENGTH)[i] = r.minor_axis_length;
+        data->column(COL_ECCENTRICITY)[i] = r.eccentricity;
+        data->column(COL_CONVEX_AREA)[i] = r.convex_area;
+        data->column(COL_EXTENT)[i] = r.extent;
+        data->column(COL_CLASS)[i] = (r.type[0] == 'C') ? 50 : -50;
+    }
+    return data;
+}
+
+#endif
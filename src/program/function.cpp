@@ -27,7 +27,9 @@
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include "function.h"
+#include <dataset.h>
 
 
 extern "C" {
@@ -102,18 +104,20 @@ DATATYPE f_rlog(int, farg* args)
 DATATYPE f_var(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->x;
+    return g->cases->value(COL_X, g->case_index);
 }
 #endif
 
 void f_erc_gen(DATATYPE* r)
 {
-    *r = (random_double(&globrand) * 2.0) - 1.0;
+    *r = (random_double(get_randomgen()) * 2.0) - 1.0;
 }
 
+// the best of run is printed on the validator thread while the main thread prints the .bst and .his files, so
+// each thread formats into a buffer of its own.
 char* f_erc_print(DATATYPE d)
 {
-    static char buffer[20];
+    thread_local char buffer[20];
     
     sprintf(buffer, "%.5f", d);
     return buffer;
@@ -123,45 +127,161 @@ char* f_erc_print(DATATYPE d)
 DATATYPE f_area(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->area;
+    return g->cases->value(COL_AREA, g->case_index);
 }
 
 DATATYPE f_perimeter(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->perimeter;
+    return g->cases->value(COL_PERIMETER, g->case_index);
 }
 
 DATATYPE f_major_axis_length(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->major_axis_length;
+    return g->cases->value(COL_MAJOR_AXIS_LENGTH, g->case_index);
 }
 
 DATATYPE f_minor_axis_length(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->minor_axis_length;
+    return g->cases->value(COL_MINOR_AXIS_LENGTH, g->case_index);
 }
 
 DATATYPE f_eccentricity(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->eccentricity;
+    return g->cases->value(COL_ECCENTRICITY, g->case_index);
 }
 
 DATATYPE f_convex_area(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->convex_area;
+    return g->cases->value(COL_CONVEX_AREA, g->case_index);
 }
 
 DATATYPE f_extent(int tree, farg* args)
 {
     globaldata* g = get_globaldata();
-    return g->extent;
+    return g->cases->value(COL_EXTENT, g->case_index);
 }
 
+#endif
+
+/*
+ * batch versions of the above. each one fills out[0..count-1] from whole argument columns; out may alias args[0],
+ * so every loop reads element i of its inputs before writing element i of the output. the loops are kept free of
+ * calls and branches so the compiler can turn them into SIMD code.
+ */
+
+void v_multiply(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    const DATATYPE* x = args[0];
+    const DATATYPE* y = args[1];
+    for (int i = 0; i < b->count; i++)
+        out[i] = x[i] * y[i];
+}
+
+void v_protdivide(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    const DATATYPE* x = args[0];
+    const DATATYPE* y = args[1];
+    // select the operands instead of the result, so the division itself is unconditional and can be vectorized.
+    for (int i = 0; i < b->count; i++)
+    {
+        DATATYPE n = y[i] == 0.0 ? 1.0 : x[i];
+        DATATYPE d = y[i] == 0.0 ? 1.0 : y[i];
+        out[i] = n / d;
+    }
+}
+
+void v_add(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    const DATATYPE* x = args[0];
+    const DATATYPE* y = args[1];
+    for (int i = 0; i < b->count; i++)
+        out[i] = x[i] + y[i];
+}
+
+void v_subtract(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    const DATATYPE* x = args[0];
+    const DATATYPE* y = args[1];
+    for (int i = 0; i < b->count; i++)
+        out[i] = x[i] - y[i];
+}
+
+void v_sin(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    for (int i = 0; i < b->count; i++)
+        out[i] = sin(args[0][i]);
+}
+
+void v_cos(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    for (int i = 0; i < b->count; i++)
+        out[i] = cos(args[0][i]);
+}
+
+void v_exp(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    for (int i = 0; i < b->count; i++)
+        out[i] = exp(args[0][i]);
+}
+
+void v_rlog(int, batchinfo* b, DATATYPE* out, DATATYPE** args)
+{
+    for (int i = 0; i < b->count; i++)
+        out[i] = args[0][i] == 0.0 ? 0.0 : log(fabs(args[0][i]));
+}
+
+// terminals read their block straight out of the shared case table, no per-thread state is involved.
+static inline void v_column(batchinfo* b, int column, DATATYPE* out)
+{
+    auto cases = static_cast<const fitness_dataset*>(b->cases);
+    std::memcpy(out, cases->column(column) + b->first, b->count * sizeof(DATATYPE));
+}
+
+#ifndef PART_B
+void v_var(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_X, out);
+}
+#else
+void v_area(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_AREA, out);
+}
+
+void v_perimeter(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_PERIMETER, out);
+}
+
+void v_major_axis_length(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_MAJOR_AXIS_LENGTH, out);
+}
+
+void v_minor_axis_length(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_MINOR_AXIS_LENGTH, out);
+}
+
+void v_eccentricity(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_ECCENTRICITY, out);
+}
+
+void v_convex_area(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_CONVEX_AREA, out);
+}
+
+void v_extent(int, batchinfo* b, DATATYPE* out, DATATYPE**)
+{
+    v_column(b, COL_EXTENT, out);
+}
 #endif
 }
 
@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "blt/std/assert.h"
 #include "blt/std/memory.h"
 
@@ -208,6 +209,19 @@ struct stt_record
         }
 };
 
+// stt_record must match the kernel's stb_record (lib/lilgp/kernel/types.h) so .stb files can be used in place
+static_assert(sizeof(stt_record) == 120 && std::is_trivially_copyable_v<stt_record>, "stt_record must match stb_record");
+
+/**
+ * Header at the start of the binary .stb file, matches the kernel's stb_header
+ */
+struct stb_header
+{
+    char magic[8];
+    std::int32_t version;
+    std::int32_t record_size;
+};
+
 /**
  * Structure used to store information loaded from the .fn file
  */
@@ -332,6 +346,54 @@ void process_stt_file(runs_stt_data& data, int& max_gen, std::string_view file)
     }
 }
 
+/**
+ * Loads the records of the binary .stb file written alongside the .stt file. The file is mapped and the records copied out
+ * as they are, without any parsing.
+ * @return false if the file is missing, empty or not in a format we know, in which case the .stt file should be used.
+ */
+bool process_stb_file(runs_stt_data& data, int& max_gen, const std::string& file)
+{
+    auto fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<blt::size_t>(st.st_size) < sizeof(stb_header))
+    {
+        close(fd);
+        return false;
+    }
+    auto size = static_cast<blt::size_t>(st.st_size);
+    auto map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        BLT_WARN("Unable to map file '%s'", file.c_str());
+        return false;
+    }
+    
+    auto bytes = static_cast<const char*>(map);
+    stb_header header{};
+    std::memcpy(&header, bytes, sizeof(stb_header));
+    if (std::memcmp(header.magic, "lilgpstb", sizeof(header.magic)) != 0 || header.version != 1 ||
+        header.record_size != sizeof(stt_record))
+    {
+        BLT_WARN("File '%s' is not a version 1 .stb file, falling back to .stt", file.c_str());
+        munmap(map, size);
+        return false;
+    }
+    
+    auto count = (size - sizeof(stb_header)) / sizeof(stt_record);
+    auto records = reinterpret_cast<const stt_record*>(bytes + sizeof(stb_header));
+    for (blt::size_t i = 0; i < count; i++)
+    {
+        max_gen = std::max(max_gen, records[i].gen);
+        data.averages[records[i].gen].push_back(records[i]);
+    }
+    
+    munmap(map, size);
+    return true;
+}
+
 inline runs_stt_data get_per_generation_averages(const std::string& outfile, int runs)
 {
     runs_stt_data data;
@@ -339,8 +401,9 @@ inline runs_stt_data get_per_generation_averages(const std::string& outfile, int
     for (int i = 0; i < runs; i++)
     {
         int max_gen = 0;
-        auto file = "./run_" + ((std::to_string(i) += "/") += outfile) += ".stt";
-        process_stt_file(data, max_gen, file);
+        auto base = "./run_" + ((std::to_string(i) += "/") += outfile);
+        if (!process_stb_file(data, max_gen, base + ".stb"))
+            process_stt_file(data, max_gen, base + ".stt");
         data.largest_generation = std::max(data.largest_generation, max_gen);
         data.total_generations += max_gen;
         data.runs_generation_size.push_back(max_gen);